@@ -4,40 +4,246 @@
 #include <cassert>
 // #define NDEBUG
 
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "NdArraySimd.hpp"
+
 // a lightweighted n-dimensional array library
 // Haohao Fu (fhh2626@gmail.com)
-// version 0.11 beta
+// version 0.12 beta
 //
 // usage:
 //   // initialize by shape (vector<int>) and default value (int, default 0)
 //   NdArray<int> arr({5,4}, 1);
 //   // copy constructor
 //   NdArray<double> arr2 = arr;
-//   // calculation
-//   std::cout << arr2 * 5 + 1;
+//   // a view of memory owned by another object (kept alive by the shared pointer),
+//   // for instance a memory-mapped file, aligned to simd::alignment bytes
+//   NdArray<double> view({5,4}, pointer, owner);
+//   // move, arr3 takes the memory of arr2, which is left empty
+//   NdArray<double> arr3 = std::move(arr2);
+//   // calculation, evaluated lazily in one loop without temporary arrays,
+//   // with simd instructions for float and double (see NdArraySimd.hpp)
+//   // an expression keeps references to its arrays, so it should be assigned to an NdArray at once
+//   // rather than kept with auto
+//   NdArray<double> arr4 = arr3 * 5 + arr3 - 1;
+//   arr4 += arr3 / 2;
+//   std::cout << arr3 * 5 + 1;
 //   // reshape
 //   // one must understand the mechanism of the reshape function
 //   // internal data are stored in a 1d array
 //   // NdArray.reshape() simply change the arrangement of the 1d array, for instance
 //   // [1,2,3,4,5,6] (shape{6}) -> [[1,2,3],[4,5,6]] (shape{2,3}) -> [[1,2],[3,4],[5,6]] (shape{3,2})
 //   arr.reshape({4,5});
-//   // return the max/min value
-//   arr.max()
+//   // return the max/min value, and their positions
+//   arr.maxValue()
+//   arr.argMin()                     // for instance {2,3}
+//   arr.unravel(7)                   // the position of a row-major index, {1,3}
 //   // get other information of the array
 //   arr.getShape()
+//   arr.getStrides()
 //   arr.getTotalSize()
 //   arr.getCArray()
+//   // the item at a row-major (flat) index, without any check
+//   arr.flat(7)
+//   // the number of items of a shape, checked against overflow
+//   NdArray::shapeProduct({360,360,360,360})
 //
 
 namespace NdArray {
 
+    // the number of items of an array of the given shape
+    // sizes are 64-bit, exit if the product does not fit
+    inline std::size_t shapeProduct(const std::vector<int>& shape) {
+        const std::uint64_t limit = std::uint64_t(std::numeric_limits<std::int64_t>::max());
+        std::uint64_t product = 1;
+        for (auto i:shape) {
+            if (i < 0) {
+                std::cerr << "Error! The shape of an array cannot be negative!" << std::endl;
+                exit(1);
+            }
+            if (i != 0 && product > limit / std::uint64_t(i)) {
+                std::cerr << "Error! The array is too large!" << std::endl;
+                exit(1);
+            }
+            product *= std::uint64_t(i);
+        }
+        return std::size_t(product);
+    }
+
+    template <typename T>
+    class NdArray;
+
+    // the arithmetic of NdArrays is lazy, arr * 5 + b builds an expression,
+    // which is evaluated item by item in a single loop when assigned to an NdArray,
+    // so no temporary array is created
+    // an expression E derives from expression<E> and has
+    //   typedef ... valueType
+    //   valueType at(std::size_t i) const        // the i-th (row-major) item
+    //   const std::vector<int>& getShape() const
+    //   std::size_t getTotalSize() const
+    //   // whether the items can be computed simd::packet<valueType>::width at a time,
+    //   // then the items i, i + 1, ... are
+    //   static const bool vectorizable
+    //   typename simd::packet<valueType>::type packet(std::size_t i) const
+    // an NdArray is itself an expression
+    template <typename E>
+    class expression {
+    public:
+        inline const E& self() const {
+            return static_cast<const E&>(*this);
+        }
+    };
+
+    // NdArrays are kept by reference in an expression, other expressions by value
+    template <typename E>
+    struct operand {
+        typedef const E type;
+    };
+
+    template <typename T>
+    struct operand<NdArray<T> > {
+        typedef const NdArray<T>& type;
+    };
+
+    // the operations of expressions, on items and on packets
+    struct plusOp {
+        static const bool vectorizable = true;
+        template <typename A, typename B>
+        static inline auto apply(A a, B b) -> decltype(a + b) {
+            return a + b;
+        }
+        template <typename P>
+        static inline typename P::type packet(typename P::type a, typename P::type b) {
+            return P::add(a, b);
+        }
+    };
+
+    struct minusOp {
+        static const bool vectorizable = true;
+        template <typename A, typename B>
+        static inline auto apply(A a, B b) -> decltype(a - b) {
+            return a - b;
+        }
+        template <typename P>
+        static inline typename P::type packet(typename P::type a, typename P::type b) {
+            return P::sub(a, b);
+        }
+    };
+
+    struct multiplyOp {
+        static const bool vectorizable = true;
+        template <typename A, typename B>
+        static inline auto apply(A a, B b) -> decltype(a * b) {
+            return a * b;
+        }
+        template <typename P>
+        static inline typename P::type packet(typename P::type a, typename P::type b) {
+            return P::mul(a, b);
+        }
+    };
+
+    struct divideOp {
+        static const bool vectorizable = true;
+        template <typename A, typename B>
+        static inline auto apply(A a, B b) -> decltype(a / b) {
+            return a / b;
+        }
+        template <typename P>
+        static inline typename P::type packet(typename P::type a, typename P::type b) {
+            return P::div(a, b);
+        }
+    };
+
+    struct modulusOp {
+        static const bool vectorizable = false;
+        template <typename A, typename B>
+        static inline auto apply(A a, B b) -> decltype(a % b) {
+            return a % b;
+        }
+    };
+
+    // an operation of two expressions of the same shape
+    template <typename L, typename R, typename Op>
+    class binaryExpression : public expression<binaryExpression<L, R, Op> > {
+    public:
+        typedef decltype(Op::apply(std::declval<typename L::valueType>(), std::declval<typename R::valueType>())) valueType;
+        typedef simd::packet<valueType> P;
+        static const bool vectorizable = P::enabled && Op::vectorizable && L::vectorizable && R::vectorizable
+            && std::is_same<typename L::valueType, valueType>::value && std::is_same<typename R::valueType, valueType>::value;
+
+        binaryExpression(const L& left, const R& right) : left(left), right(right) {
+            assert(left.getShape() == right.getShape());
+        }
+
+        inline valueType at(std::size_t i) const {
+            return Op::apply(this->left.at(i), this->right.at(i));
+        }
+
+        inline typename P::type packet(std::size_t i) const {
+            return Op::template packet<P>(this->left.packet(i), this->right.packet(i));
+        }
+
+        const std::vector<int>& getShape() const {
+            return this->left.getShape();
+        }
+
+        std::size_t getTotalSize() const {
+            return this->left.getTotalSize();
+        }
+
+    private:
+        typename operand<L>::type left;
+        typename operand<R>::type right;
+    };
+
+    // an operation of an expression and a number
+    // numberFirst means num op arr, otherwise arr op num
+    template <typename E, typename Op, bool numberFirst>
+    class scalarExpression : public expression<scalarExpression<E, Op, numberFirst> > {
+    public:
+        typedef typename E::valueType valueType;
+        typedef simd::packet<valueType> P;
+        static const bool vectorizable = P::enabled && Op::vectorizable && E::vectorizable;
+
+        scalarExpression(const E& arr, const valueType& num) : arr(arr), num(num) {}
+
+        inline valueType at(std::size_t i) const {
+            return numberFirst ? valueType(Op::apply(this->num, this->arr.at(i))) : valueType(Op::apply(this->arr.at(i), this->num));
+        }
+
+        inline typename P::type packet(std::size_t i) const {
+            return numberFirst ? Op::template packet<P>(P::set1(this->num), this->arr.packet(i)) : Op::template packet<P>(this->arr.packet(i), P::set1(this->num));
+        }
+
+        const std::vector<int>& getShape() const {
+            return this->arr.getShape();
+        }
+
+        std::size_t getTotalSize() const {
+            return this->arr.getTotalSize();
+        }
+
+    private:
+        typename operand<E>::type arr;
+        valueType num;
+    };
+
     // NdArray class
     template <typename T>
-    class NdArray {
+    class NdArray : public expression<NdArray<T> > {
     public:
+        typedef T valueType;
+        typedef simd::packet<T> P;
+        static const bool vectorizable = P::enabled;
+
         // default constructor of NdArray
         NdArray(const std::vector<int>& shape, T defaultValue = 0) {
 
@@ -47,17 +253,15 @@ namespace NdArray {
             this->shape = shape;
 
             // calculate the length of the internal array
-            this->totalSize = 1;
-            for (auto i:shape) {
-                this->totalSize *= i;
-            }
+            this->totalSize = shapeProduct(shape);
+            this->computeStrides();
 
             assert(this->totalSize != 0);
 
             // get memory
-            this->data = new T[totalSize];
+            this->data = simd::allocate<T>(this->totalSize);
             // initialize the new array
-            for (int i = 0; i < this->totalSize; i++) {
+            for (std::size_t i = 0; i < this->totalSize; i++) {
                 this->data[i] = defaultValue;
             }
         }
@@ -67,157 +271,181 @@ namespace NdArray {
 
             this->totalSize = arr.getTotalSize();
             this->shape = arr.getShape();
-            this->data = new T[this->totalSize];
-            for (int i = 0; i < this->totalSize; i++) {
+            this->strides = arr.getStrides();
+            this->data = simd::allocate<T>(this->totalSize);
+            for (std::size_t i = 0; i < this->totalSize; i++) {
                 this->data[i] = arr.getCArray()[i];
             }
         }
 
+        // an array over external memory, which is not freed by the array
+        // owner keeps the memory alive as long as the array (or any array moved from it) exists
+        NdArray(const std::vector<int>& shape, T* external, std::shared_ptr<void> owner) {
+
+            assert(std::uintptr_t(external) % simd::alignment == 0);
+
+            this->shape = shape;
+            this->totalSize = shapeProduct(shape);
+            this->computeStrides();
+            this->data = external;
+            this->owner = std::move(owner);
+        }
+
+        // move constructor, takes the memory of arr, which is left empty
+        NdArray(NdArray&& arr) noexcept
+            : data(arr.data), totalSize(arr.totalSize), shape(std::move(arr.shape)), strides(std::move(arr.strides)), owner(std::move(arr.owner)) {
+            arr.data = nullptr;
+            arr.totalSize = 0;
+            arr.shape.clear();
+            arr.strides.clear();
+        }
+
         // type change constructor
         template <typename U>
         NdArray(const NdArray<U>& arr) {
 
             this->totalSize = arr.getTotalSize();
             this->shape = arr.getShape();
-            this->data = new T[this->totalSize];
-            for (int i = 0; i < this->totalSize; i++) {
+            this->strides = arr.getStrides();
+            this->data = simd::allocate<T>(this->totalSize);
+            for (std::size_t i = 0; i < this->totalSize; i++) {
                 this->data[i] = T(arr.getCArray()[i]);
             }
         }
 
-        // operator[] to get the desired item at a given pos
-        T& operator[] (const std::vector<int>& pos) {
-            return data[position(pos)];
-        }
+        // evaluate an expression
+        template <typename E>
+        NdArray(const expression<E>& expr) {
 
-        // operator +
-        NdArray operator+ (const NdArray& arr) const {
-            assert(this->shape == arr.shape);
-            NdArray sumArr = arr;
-            for (int i = 0; i < arr.totalSize; i++) {
-                sumArr.data[i] += this->data[i];
-            }
-            return sumArr;
+            const E& e = expr.self();
+            this->totalSize = e.getTotalSize();
+            this->shape = e.getShape();
+            this->computeStrides();
+            this->data = simd::allocate<T>(this->totalSize);
+            this->evaluate(e);
         }
 
-        NdArray operator+ (const T& num) const {
-            NdArray sumArr = *this;
-            for (int i = 0; i < this->totalSize; i++) {
-                sumArr.data[i] += num;
+        // copy assignment
+        NdArray& operator= (const NdArray& arr) {
+            if (this == &arr) {
+                return *this;
             }
-            return sumArr;
-        }
-
-        friend NdArray operator+ (const T& num, const NdArray& arr) {
-            return arr + num;
+            if (this->totalSize != arr.totalSize) {
+                return *this = NdArray(arr);
+            }
+            this->shape = arr.shape;
+            this->strides = arr.strides;
+            for (std::size_t i = 0; i < this->totalSize; i++) {
+                this->data[i] = arr.data[i];
+            }
+            return *this;
         }
 
-        // operator +=
-        NdArray operator+= (const NdArray& arr) {
-            assert(this->shape == arr.shape);
-            for (int i = 0; i < this->totalSize; i++) {
-                this->data[i] += arr.data[i];
+        // move assignment
+        NdArray& operator= (NdArray&& arr) noexcept {
+            if (this != &arr) {
+                this->release();
+                this->data = arr.data;
+                this->totalSize = arr.totalSize;
+                this->shape = std::move(arr.shape);
+                this->strides = std::move(arr.strides);
+                this->owner = std::move(arr.owner);
+                arr.data = nullptr;
+                arr.totalSize = 0;
+                arr.shape.clear();
+                arr.strides.clear();
             }
             return *this;
         }
 
-        NdArray& operator+= (const T& num) {
-            for (int i = 0; i < this->totalSize; i++) {
-                this->data[i] += num;
+        // evaluate an expression into this array
+        // the memory is reused if the expression has the same shape,
+        // an expression may read this array, as each item only depends on the same item
+        template <typename E>
+        NdArray& operator= (const expression<E>& expr) {
+            const E& e = expr.self();
+            if (e.getShape() != this->shape) {
+                return *this = NdArray(expr);
             }
+            this->evaluate(e);
             return *this;
         }
 
-        // operator -
-        NdArray operator- (const NdArray& arr) const {
-            assert(this->shape == arr.shape);
-            NdArray sumArr = *this;
-            for (int i = 0; i < arr.totalSize; i++) {
-                sumArr.data[i] -= arr.data[i];
-            }
-            return sumArr;
+        // operator[] to get the desired item at a given pos
+        T& operator[] (const std::vector<int>& pos) {
+            return data[position(pos)];
         }
 
-        NdArray operator- (const T& num) const {
-            NdArray sumArr = *this;
-            for (int i = 0; i < this->totalSize; i++) {
-                sumArr.data[i] -= num;
-            }
-            return sumArr;
+        const T& operator[] (const std::vector<int>& pos) const {
+            return data[position(pos)];
         }
 
-        // operator *
-        NdArray operator* (const NdArray& arr) const {
-            assert(this->shape == arr.shape);
-            NdArray sumArr = *this;
-            for (int i = 0; i < arr.totalSize; i++) {
-                sumArr.data[i] *= arr.data[i];
-            }
-            return sumArr;
+        // the item at a row-major index, unchecked, for hot loops
+        inline T& flat(std::size_t index) {
+            return this->data[index];
         }
 
-        NdArray operator* (const T& num) const {
-            NdArray sumArr = *this;
-            for (int i = 0; i < this->totalSize; i++) {
-                sumArr.data[i] *= num;
-            }
-            return sumArr;
+        inline const T& flat(std::size_t index) const {
+            return this->data[index];
         }
 
-        friend NdArray operator* (const T& num, const NdArray& arr) {
-            return arr * num;
+        // the item at a row-major index, as an expression
+        inline T at(std::size_t index) const {
+            return this->data[index];
         }
 
-        // operator *=
-        NdArray operator*= (const NdArray& arr) {
-            assert(this->shape == arr.shape);
-            for (int i = 0; i < this->totalSize; i++) {
-                this->data[i] *= arr.data[i];
-            }
-            return *this;
+        // the items from a row-major index, as an expression
+        // the storage is aligned and index is a multiple of the packet width
+        inline typename P::type packet(std::size_t index) const {
+            return P::load(this->data + index);
         }
 
-        NdArray& operator*= (const T& num) {
-            for (int i = 0; i < this->totalSize; i++) {
-                this->data[i] *= num;
-            }
-            return *this;
+        // operator +=
+        // evaluated as *this = *this + expr, in place
+        template <typename E>
+        NdArray& operator+= (const expression<E>& expr) {
+            assert(this->shape == expr.self().getShape());
+            return *this = *this + expr;
         }
 
-        // operator /
-        NdArray operator/ (const NdArray& arr) const {
-            assert(this->shape == arr.shape);
-            NdArray sumArr = *this;
-            for (int i = 0; i < arr.totalSize; i++) {
-                sumArr.data[i] /= arr.data[i];
-            }
-            return sumArr;
+        NdArray& operator+= (const T& num) {
+            return *this = *this + num;
         }
 
-        NdArray operator/ (const T& num) const {
-            NdArray sumArr = *this;
-            for (int i = 0; i < this->totalSize; i++) {
-                sumArr.data[i] /= num;
-            }
-            return sumArr;
+        // operator -=
+        // evaluated as *this = *this - expr, in place
+        template <typename E>
+        NdArray& operator-= (const expression<E>& expr) {
+            assert(this->shape == expr.self().getShape());
+            return *this = *this - expr;
         }
 
-        // operator %
-        NdArray operator% (const NdArray& arr) const {
-            assert(this->shape == arr.shape);
-            NdArray sumArr = *this;
-            for (int i = 0; i < arr.totalSize; i++) {
-                sumArr.data[i] %= arr.data[i];
-            }
-            return sumArr;
+        NdArray& operator-= (const T& num) {
+            return *this = *this - num;
         }
 
-        NdArray operator% (const T& num) const {
-            NdArray sumArr = *this;
-            for (int i = 0; i < this->totalSize; i++) {
-                sumArr.data[i] %= num;
-            }
-            return sumArr;
+        // operator *=
+        // evaluated as *this = *this * expr, in place
+        template <typename E>
+        NdArray& operator*= (const expression<E>& expr) {
+            assert(this->shape == expr.self().getShape());
+            return *this = *this * expr;
+        }
+
+        NdArray& operator*= (const T& num) {
+            return *this = *this * num;
+        }
+
+        // operator /=
+        // evaluated as *this = *this / expr, in place
+        template <typename E>
+        NdArray& operator/= (const expression<E>& expr) {
+            assert(this->shape == expr.self().getShape());
+            return *this = *this / expr;
+        }
+
+        NdArray& operator/= (const T& num) {
+            return *this = *this / num;
         }
 
         // operator <<
@@ -249,42 +477,47 @@ namespace NdArray {
 
         // return the max value
         T maxValue() const {
-            T maxN = this->data[0];
-            for (int i = 0; i < this->totalSize; i++) {
-                if (this->data[i] > maxN) {
-                    maxN = data[i];
-                }
-            }
-            return maxN;
+            return simd::maxValue(this->data, this->totalSize);
         }
 
         // return the min value
-        // return the max value
         T minValue() const {
-            T minN = this->data[0];
-            for (int i = 0; i < this->totalSize; i++) {
-                if (this->data[i] < minN) {
-                    minN = data[i];
-                }
+            return simd::minValue(this->data, this->totalSize);
+        }
+
+        // return the position of the max value, the first one if there are several
+        std::vector<int> argMax() const {
+            return this->unravel(simd::argMax(this->data, this->totalSize));
+        }
+
+        // return the position of the min value, the first one if there are several
+        std::vector<int> argMin() const {
+            return this->unravel(simd::argMin(this->data, this->totalSize));
+        }
+
+        // the position of a row-major index
+        std::vector<int> unravel(std::size_t index) const {
+            std::vector<int> pos(this->shape.size());
+            for (std::size_t i = 0; i < this->shape.size(); i++) {
+                pos[i] = int(index / this->strides[i]);
+                index %= this->strides[i];
             }
-            return minN;
+            return pos;
         }
 
         // reshape the nd array
         void reshape(const std::vector<int>& newShape) {
             // calculate the length corresponding the new shape
-            int totalSize = 1;
-            for (auto i:newShape) {
-                totalSize *= i;
-            }
+            std::size_t totalSize = shapeProduct(newShape);
 
-            assert(this->totalSize = totalSize);
+            assert(this->totalSize == totalSize);
 
             this->shape = newShape;
+            this->computeStrides();
         }
 
         // return the totol size of the ndArray
-        int getTotalSize() const {
+        std::size_t getTotalSize() const {
             return this->totalSize;
         }
 
@@ -293,41 +526,165 @@ namespace NdArray {
             return this->shape;
         }
 
+        // return the row-major stride of each dimension
+        const std::vector<std::size_t>& getStrides() const {
+            return this->strides;
+        }
+
+        // whether the items are external memory, see the constructor of views
+        bool isView() const {
+            return this->owner != nullptr;
+        }
+
         // get the C-style Array
         const T* const getCArray() const {
             return this->data;
         }
 
+        T* getCArray() {
+            return this->data;
+        }
+
         // default destructor
         ~NdArray() {
-            delete[] data;
+            this->release();
         }
 
     private:
 
+        // write the items of an expression into the array,
+        // a packet at a time if the expression is vectorizable
+        template <typename E>
+        void evaluate(const E& e) {
+            std::size_t i = 0;
+            this->evaluatePackets(e, i, std::integral_constant<bool, E::vectorizable && std::is_same<typename E::valueType, T>::value>());
+            for (; i < this->totalSize; i++) {
+                this->data[i] = T(e.at(i));
+            }
+        }
+
+        template <typename E>
+        void evaluatePackets(const E& e, std::size_t& i, std::true_type) {
+            for (; i + P::width <= this->totalSize; i += P::width) {
+                P::store(this->data + i, e.packet(i));
+            }
+        }
+
+        template <typename E>
+        void evaluatePackets(const E&, std::size_t&, std::false_type) {}
+
+        // free the memory, unless it is external
+        void release() {
+            if (this->owner != nullptr) {
+                this->owner.reset();
+            }
+            else {
+                simd::deallocate(this->data);
+            }
+            this->data = nullptr;
+        }
+
+        // the row-major strides, computed once for each shape
+        void computeStrides() {
+            this->strides = std::vector<std::size_t>(this->shape.size(), 1);
+            for (int i = int(this->shape.size()) - 2; i >= 0; i--) {
+                this->strides[i] = this->strides[i + 1] * this->shape[i + 1];
+            }
+        }
+
         // find the real position of an item based on a vector
-        int position(const std::vector<int>& pos) const {
+        inline std::size_t position(const std::vector<int>& pos) const {
             assert(pos.size() == this->shape.size());
 
-            int realPos = 0;
-            int tempSum = 0;
-            for (int i = 0; i < pos.size(); i++) {
-                tempSum = pos[i];
-                for (int j = i + 1; j < pos.size(); j++) {
-                    tempSum *= this->shape[j];
-                }
-                realPos += tempSum;
+            std::size_t realPos = 0;
+            for (std::size_t i = 0; i < pos.size(); i++) {
+                realPos += pos[i] * this->strides[i];
             }
             return realPos;
         }
 
-        // pointers to data
+        // pointers to data, aligned to simd::alignment bytes
         T* data;
         // the total number of items
-        int totalSize;
+        std::size_t totalSize;
         // the shape of the NdArray
         std::vector<int> shape;
+        // the row-major stride of each dimension
+        std::vector<std::size_t> strides;
+        // the owner of external memory, nullptr if the memory belongs to the array
+        std::shared_ptr<void> owner;
     };
+
+    // operator +
+    template <typename L, typename R>
+    inline binaryExpression<L, R, plusOp> operator+ (const expression<L>& left, const expression<R>& right) {
+        return binaryExpression<L, R, plusOp>(left.self(), right.self());
+    }
+
+    template <typename E>
+    inline scalarExpression<E, plusOp, false> operator+ (const expression<E>& arr, const typename E::valueType& num) {
+        return scalarExpression<E, plusOp, false>(arr.self(), num);
+    }
+
+    template <typename E>
+    inline scalarExpression<E, plusOp, true> operator+ (const typename E::valueType& num, const expression<E>& arr) {
+        return scalarExpression<E, plusOp, true>(arr.self(), num);
+    }
+
+    // operator -
+    template <typename L, typename R>
+    inline binaryExpression<L, R, minusOp> operator- (const expression<L>& left, const expression<R>& right) {
+        return binaryExpression<L, R, minusOp>(left.self(), right.self());
+    }
+
+    template <typename E>
+    inline scalarExpression<E, minusOp, false> operator- (const expression<E>& arr, const typename E::valueType& num) {
+        return scalarExpression<E, minusOp, false>(arr.self(), num);
+    }
+
+    // operator *
+    template <typename L, typename R>
+    inline binaryExpression<L, R, multiplyOp> operator* (const expression<L>& left, const expression<R>& right) {
+        return binaryExpression<L, R, multiplyOp>(left.self(), right.self());
+    }
+
+    template <typename E>
+    inline scalarExpression<E, multiplyOp, false> operator* (const expression<E>& arr, const typename E::valueType& num) {
+        return scalarExpression<E, multiplyOp, false>(arr.self(), num);
+    }
+
+    template <typename E>
+    inline scalarExpression<E, multiplyOp, true> operator* (const typename E::valueType& num, const expression<E>& arr) {
+        return scalarExpression<E, multiplyOp, true>(arr.self(), num);
+    }
+
+    // operator /
+    template <typename L, typename R>
+    inline binaryExpression<L, R, divideOp> operator/ (const expression<L>& left, const expression<R>& right) {
+        return binaryExpression<L, R, divideOp>(left.self(), right.self());
+    }
+
+    template <typename E>
+    inline scalarExpression<E, divideOp, false> operator/ (const expression<E>& arr, const typename E::valueType& num) {
+        return scalarExpression<E, divideOp, false>(arr.self(), num);
+    }
+
+    // operator %
+    template <typename L, typename R>
+    inline binaryExpression<L, R, modulusOp> operator% (const expression<L>& left, const expression<R>& right) {
+        return binaryExpression<L, R, modulusOp>(left.self(), right.self());
+    }
+
+    template <typename E>
+    inline scalarExpression<E, modulusOp, false> operator% (const expression<E>& arr, const typename E::valueType& num) {
+        return scalarExpression<E, modulusOp, false>(arr.self(), num);
+    }
+
+    // operator << of an expression, which is evaluated first
+    template <typename E>
+    std::ostream& operator<< (std::ostream& out, const expression<E>& expr) {
+        return out << NdArray<typename E::valueType>(expr);
+    }
 }
 
 #endif // NDARRAY_HPP
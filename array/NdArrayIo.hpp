@@ -1,12 +1,37 @@
 #ifndef NDARRAYIO_HPP
 #define NDARRAYIO_HPP
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
+#if !defined(__cpp_lib_to_chars)
+#include <cstdio>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NDARRAY_MMAP
+#endif
+
 #include "NdArray.hpp"
 #include "pystring.h"
 #include "pystring.cpp"
@@ -17,6 +42,27 @@
 //   auto a = NdArray::readDat(file, 0.0);
 //   // write and NdArray into a external file
 //   NdArray::writeDat("file.txt", arr);
+//   // map a file into memory, pages are read on first access
+//   // and copied only if written (the file itself is never modified)
+//   auto m = std::make_shared<NdArray::mappedFile>("file.bin");
+//   m->data(); m->size();
+//   // on systems without mmap, the file is read into aligned memory
+//   // read the numbers of a text file line by line, without allocation
+//   NdArray::textReader r("file.txt");
+//   double x;
+//   while (r.nextLine()) {
+//       if (r.startsWith('#')) continue;   // a comment
+//       r.skip();                          // skip a token
+//       while (r.read(x)) { ... }          // the numbers left in the line
+//   }
+//   // or read the rest of the file in newline-aligned chunks, on all cores
+//   r.forEachChunk([&](NdArray::textReader& chunk, std::size_t index) { while (chunk.nextLine()) { ... } });
+//   // write numbers as std::ostream does by default (6 significant digits),
+//   // into a large buffer written in blocks, by a background thread if asked
+//   NdArray::textWriter w("file.txt", true);
+//   w << 1.5 << " " << 3 << "\n";
+//   w.close();                             // or when w is destroyed
+//
 //
 // note:
 //   if this file is included, one must also include pystring
@@ -24,69 +70,477 @@
 
 namespace NdArray {
 
+    // a whole file mapped into memory, private to the process
+    // the address is page-aligned, so offsets aligned to simd::alignment give aligned arrays
+    class mappedFile {
+
+    public:
+
+        explicit mappedFile(const std::string& file) : base(nullptr), length(0) {
+#ifdef NDARRAY_MMAP
+            int fd = open(file.c_str(), O_RDONLY);
+            struct stat info;
+            if (fd == -1 || fstat(fd, &info) != 0) {
+                std::cerr << "file " << file << " cannot be opened!" << std::endl;
+                exit(1);
+            }
+            this->length = std::size_t(info.st_size);
+            if (this->length > 0) {
+                void* p = mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) {
+                    std::cerr << "file " << file << " cannot be mapped into memory!" << std::endl;
+                    exit(1);
+                }
+                this->base = static_cast<char*>(p);
+            }
+            close(fd);
+#else
+            std::ifstream readFile(file, std::ios::in | std::ios::binary | std::ios::ate);
+            if (!readFile.is_open()) {
+                std::cerr << "file " << file << " cannot be opened!" << std::endl;
+                exit(1);
+            }
+            this->length = std::size_t(readFile.tellg());
+            this->base = simd::allocate<char>(this->length);
+            readFile.seekg(0);
+            readFile.read(this->base, this->length);
+#endif
+        }
+
+        mappedFile(const mappedFile&) = delete;
+        mappedFile& operator= (const mappedFile&) = delete;
+
+        char* data() {
+            return this->base;
+        }
+
+        const char* data() const {
+            return this->base;
+        }
+
+        std::size_t size() const {
+            return this->length;
+        }
+
+        ~mappedFile() {
+#ifdef NDARRAY_MMAP
+            if (this->base != nullptr) {
+                munmap(this->base, this->length);
+            }
+#else
+            simd::deallocate(this->base);
+#endif
+        }
+
+    private:
+
+        char* base;
+        std::size_t length;
+    };
+
+    // parse a number at the beginning of [first, last)
+    // return the end of the number, or nullptr if there is none
+    inline const char* parseNumber(const char* first, const char* last, double& value) {
+        // like std::stod, a leading + is accepted
+        if (first != last && *first == '+') {
+            first++;
+        }
+#if defined(__cpp_lib_to_chars)
+        auto result = std::from_chars(first, last, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+        // strtod needs a terminated string, numbers are short
+        char buffer[64];
+        std::size_t length = std::min(std::size_t(last - first), sizeof(buffer) - 1);
+        std::memcpy(buffer, first, length);
+        buffer[length] = '\0';
+        char* end;
+        value = std::strtod(buffer, &end);
+        return end == buffer ? nullptr : first + (end - buffer);
+#endif
+    }
+
+    // a streaming reader of the whitespace separated numbers of a text file
+    // the file is mapped into memory and read line by line in place,
+    // numbers are parsed with std::from_chars (strtod before C++17)
+    class textReader {
+
+    public:
+
+        explicit textReader(const std::string& file)
+            : file(file), mapping(std::make_shared<const mappedFile>(file)) {
+            this->begin = this->mapping->data();
+            this->end = this->begin + this->mapping->size();
+            this->next = this->lineStart = this->lineEnd = this->cursor = this->begin;
+        }
+
+        // split the rest of the file into (at most) parts readers of newline-aligned chunks
+        // the chunks share the mapping of this reader
+        std::vector<textReader> split(std::size_t parts) const {
+            std::vector<textReader> chunks;
+            const char* first = this->next;
+            for (std::size_t i = 1; i <= parts && first != this->end; i++) {
+                const char* last = this->end;
+                if (i < parts) {
+                    last = first + std::size_t(this->end - first) / (parts - i + 1);
+                    const char* newline = static_cast<const char*>(std::memchr(last, '\n', this->end - last));
+                    last = (newline == nullptr) ? this->end : newline + 1;
+                }
+                textReader chunk(*this);
+                chunk.next = chunk.lineStart = chunk.lineEnd = chunk.cursor = first;
+                chunk.end = last;
+                chunks.push_back(chunk);
+                first = last;
+            }
+            return chunks;
+        }
+
+        // call f(chunk, index) for each newline-aligned chunk of the rest of the file,
+        // the index-th of at most threadNum chunks, in file order
+        // each chunk in a thread, threadNum = 0 means all cores
+        // small files are read by a single chunk in this thread
+        // the lines of different chunks must not write the same memory
+        template <typename F>
+        void forEachChunk(F f, unsigned threadNum = 0) {
+            const std::size_t minChunkSize = std::size_t(1) << 20;
+            if (threadNum == 0) {
+                threadNum = std::max(1u, std::thread::hardware_concurrency());
+            }
+            std::size_t parts = std::min(std::size_t(threadNum), std::max(std::size_t(1), std::size_t(this->end - this->next) / minChunkSize));
+            std::vector<textReader> chunks = this->split(parts);
+            if (chunks.size() == 1) {
+                f(chunks[0], std::size_t(0));
+            }
+            else {
+                std::vector<std::thread> threads;
+                for (std::size_t i = 0; i < chunks.size(); i++) {
+                    threads.emplace_back([&f, &chunks, i]() { f(chunks[i], i); });
+                }
+                for (auto& t : threads) {
+                    t.join();
+                }
+            }
+            this->next = this->lineStart = this->lineEnd = this->cursor = this->end;
+        }
+
+        // move to the next line, false at the end of the file
+        bool nextLine() {
+            if (this->next == this->end) {
+                return false;
+            }
+            const char* newline = static_cast<const char*>(std::memchr(this->next, '\n', this->end - this->next));
+            this->lineStart = this->cursor = this->next;
+            this->lineEnd = (newline == nullptr) ? this->end : newline;
+            this->next = (newline == nullptr) ? this->end : newline + 1;
+            return true;
+        }
+
+        // whether the current line starts with c
+        bool startsWith(char c) const {
+            return this->lineStart != this->lineEnd && *(this->lineStart) == c;
+        }
+
+        // skip the next token of the current line, false if there is none
+        bool skip() {
+            if (!this->findToken()) {
+                return false;
+            }
+            this->skipToken();
+            return true;
+        }
+
+        // read the next number of the current line, false if there is none
+        // anything following the number in the same token is ignored, as std::stod does
+        template <typename U>
+        bool read(U& value) {
+            if (!this->findToken()) {
+                return false;
+            }
+            double number;
+            const char* numberEnd = parseNumber(this->cursor, this->lineEnd, number);
+            if (numberEnd == nullptr) {
+                std::cerr << "Error! Cannot read a number at line " << this->getLineNumber() << " of " << this->file << "!" << std::endl;
+                exit(1);
+            }
+            value = U(number);
+            this->cursor = numberEnd;
+            this->skipToken();
+            return true;
+        }
+
+        // the number of the current line in the file, from 1, counted on demand
+        std::size_t getLineNumber() const {
+            return std::count(this->begin, this->lineStart, '\n') + 1;
+        }
+
+    private:
+
+        static inline bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        // move the cursor to the next token, false if the line ends first
+        bool findToken() {
+            while (this->cursor != this->lineEnd && isSpace(*(this->cursor))) {
+                this->cursor++;
+            }
+            return this->cursor != this->lineEnd;
+        }
+
+        // move the cursor to the end of the current token
+        void skipToken() {
+            while (this->cursor != this->lineEnd && !isSpace(*(this->cursor))) {
+                this->cursor++;
+            }
+        }
+
+        std::string file;
+        std::shared_ptr<const mappedFile> mapping;
+        // the start of the file, the end of the part read, and the start of the line after the current one
+        const char* begin;
+        const char* end;
+        const char* next;
+        const char* lineStart;
+        const char* lineEnd;
+        const char* cursor;
+    };
+
     // read a datfile into a 2d NdArray
+    // lines starting with # and blank lines are skipped,
+    // the col num is determined by the first row, shorter rows are filled with 0
     template<typename T>
     NdArray<T> readDat(const std::string& file, T dummyVar) {
 
         static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value, "T must be a number");
 
-        std::ifstream readFile;
-        readFile.open(file, std::ios::in);
-        if (!readFile.is_open()) {
-            std::cerr << "file cannot open!" << std::endl;
+        textReader reader(file);
+
+        // the first row, which determines the col num
+        std::vector<T> firstRow;
+        T value;
+        while (firstRow.empty() && reader.nextLine()) {
+            if (reader.startsWith('#')) {
+                continue;
+            }
+            while (reader.read(value)) {
+                firstRow.push_back(value);
+            }
+        }
+        std::size_t cols = firstRow.size();
+        std::size_t rows = cols == 0 ? 0 : 1;
+
+        // the other rows, in parallel chunks, each chunk into its own block of rows
+        unsigned threadNum = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::vector<T> > blocks(threadNum);
+        reader.forEachChunk([&](textReader& chunk, std::size_t index) {
+            std::vector<T>& block = blocks[index];
+            T number;
+            while (chunk.nextLine()) {
+                if (chunk.startsWith('#') || !chunk.read(number)) {
+                    continue;
+                }
+                block.push_back(number);
+                std::size_t col = 1;
+                for (; col < cols && chunk.read(number); col++) {
+                    block.push_back(number);
+                }
+                block.resize(block.size() + (cols - col), T(0));
+            }
+        }, threadNum);
+        for (const auto& block : blocks) {
+            rows += block.size() / std::max(cols, std::size_t(1));
+        }
+
+        if (rows == 0) {
+            std::cerr << "Error! No data in " << file << "!" << std::endl;
+            exit(1);
+        }
+        if (rows > std::size_t(std::numeric_limits<int>::max())) {
+            std::cerr << "Error! Too many lines in " << file << "!" << std::endl;
             exit(1);
         }
 
-        // all lines in memory
-        std::vector<std::vector<std::string> > allLines;
+        NdArray<T> data({int(rows), int(cols)});
+        T* item = std::copy(firstRow.begin(), firstRow.end(), data.getCArray());
+        for (const auto& block : blocks) {
+            item = std::copy(block.begin(), block.end(), item);
+        }
 
-        // used for parsing
-        std::string line;
-        std::vector<std::string> splitedLine;
+        return data;
+    }
 
-        // read the file into memory
-        while (getline(readFile, line)) {
-            if (pystring::startswith(line,"#")) {
-                continue;
+    // a buffered writer of text files
+    // numbers are formatted with std::to_chars (snprintf before C++17) into a buffer,
+    // which is written in blocks of bufferSize bytes
+    // in the background mode, a full buffer is written by another thread
+    // while the next one is filled
+    class textWriter {
+
+    public:
+
+        explicit textWriter(const std::string& file, bool background = false, std::size_t bufferSize = std::size_t(1) << 20)
+            : file(file), used(0), pending(0), stopping(false) {
+            // text mode, so that the line endings are those of the platform
+            this->stream.open(file, std::ios::out);
+            if (!this->stream.is_open()) {
+                std::cerr << "Cannot open " << file << std::endl;
+                exit(1);
             }
-            pystring::split(line, splitedLine);
-            if (splitedLine.size() == 0) {
-                continue;
+            // room for the longest number after the limit
+            this->front.resize(bufferSize + maxNumberLength);
+            this->limit = bufferSize;
+            if (background) {
+                this->back.resize(this->front.size());
+                this->writer = std::thread(&textWriter::writeInBackground, this);
             }
-            allLines.push_back(splitedLine);
         }
 
-        // the shape of the matrix
-        // the col num is determined by the first row
-        std::vector<int> shape = {int(allLines.size()), int(allLines[0].size())};
-        NdArray<T> data(shape);
+        textWriter(const textWriter&) = delete;
+        textWriter& operator= (const textWriter&) = delete;
 
-        for (int i = 0; i < shape[0]; i++) {
-            for (int j = 0; j < shape[1]; j++) {
-                if (j < allLines[i].size()) {
-                    data[{i, j}] = std::stod(allLines[i][j]);
+        textWriter& operator<< (const char* text) {
+            return this->append(text, std::strlen(text));
+        }
+
+        textWriter& operator<< (const std::string& text) {
+            return this->append(text.data(), text.size());
+        }
+
+        textWriter& operator<< (char c) {
+            this->front[this->used++] = c;
+            this->flushIfFull();
+            return *this;
+        }
+
+        // numbers, 6 significant digits like std::ostream for floating-point numbers
+        template <typename U>
+        typename std::enable_if<std::is_arithmetic<U>::value, textWriter&>::type operator<< (U value) {
+            char* first = this->front.data() + this->used;
+            this->used += formatNumber(first, first + maxNumberLength, value, std::is_floating_point<U>()) - first;
+            this->flushIfFull();
+            return *this;
+        }
+
+        // write everything and close the file
+        void close() {
+            if (!this->stream.is_open()) {
+                return;
+            }
+            this->flush();
+            if (this->writer.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    this->stopping = true;
+                }
+                this->changed.notify_all();
+                this->writer.join();
+            }
+            this->stream.close();
+            if (this->stream.fail()) {
+                std::cerr << "Error! Cannot write " << this->file << "!" << std::endl;
+                exit(1);
+            }
+        }
+
+        ~textWriter() {
+            this->close();
+        }
+
+    private:
+
+        // longer than any number written by formatNumber
+        static const std::size_t maxNumberLength = 64;
+
+        template <typename U>
+        static char* formatNumber(char* first, char* last, U value, std::true_type) {
+#if defined(__cpp_lib_to_chars)
+            return std::to_chars(first, last, value, std::chars_format::general, 6).ptr;
+#else
+            return first + std::snprintf(first, last - first, "%g", double(value));
+#endif
+        }
+
+        template <typename U>
+        static char* formatNumber(char* first, char* last, U value, std::false_type) {
+#if defined(__cpp_lib_to_chars)
+            return std::to_chars(first, last, value).ptr;
+#else
+            return first + std::snprintf(first, last - first, "%lld", (long long)(value));
+#endif
+        }
+
+        textWriter& append(const char* text, std::size_t length) {
+            while (length > 0) {
+                std::size_t part = std::min(length, this->front.size() - this->used);
+                std::memcpy(this->front.data() + this->used, text, part);
+                this->used += part;
+                text += part;
+                length -= part;
+                this->flushIfFull();
+            }
+            return *this;
+        }
+
+        inline void flushIfFull() {
+            if (this->used >= this->limit) {
+                this->flush();
+            }
+        }
+
+        // hand the buffer to the writer thread, or write it here
+        void flush() {
+            if (!this->writer.joinable()) {
+                this->stream.write(this->front.data(), this->used);
+                this->used = 0;
+                return;
+            }
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->changed.wait(lock, [this]() { return this->pending == 0; });
+            this->front.swap(this->back);
+            this->pending = this->used;
+            this->used = 0;
+            lock.unlock();
+            this->changed.notify_all();
+        }
+
+        void writeInBackground() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            while (true) {
+                this->changed.wait(lock, [this]() { return this->pending != 0 || this->stopping; });
+                if (this->pending != 0) {
+                    // the back buffer is not touched by the other thread while pending
+                    lock.unlock();
+                    this->stream.write(this->back.data(), this->pending);
+                    lock.lock();
+                    this->pending = 0;
+                    this->changed.notify_all();
                 }
                 else {
-                    data[{i, j}] = 0;
+                    return;
                 }
             }
         }
 
-        readFile.close();
-
-        return data;
-    }
+        std::string file;
+        std::ofstream stream;
+        // the buffer being filled, and the one being written in the background
+        std::vector<char> front;
+        std::vector<char> back;
+        std::size_t used;
+        std::size_t limit;
+        // the bytes of back still to be written
+        std::size_t pending;
+        bool stopping;
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable changed;
+    };
 
     // write an 2d NdArray to a datFile
     template<typename T>
-    void writeDat(const std::string& file, NdArray<T> arr) {
+    void writeDat(const std::string& file, const NdArray<T>& arr) {
 
-        std::ofstream writeFile;
-        writeFile.open(file, std::ios::out);
-        if (!writeFile.is_open()) {
-            std::cerr << "file cannot open!" << std::endl;
-            exit(1);
-        }
+        textWriter writeFile(file);
 
         auto shape = arr.getShape();
         for (int i = 0; i < shape[0]; i++) {
@@ -0,0 +1,294 @@
+#ifndef NDARRAYSIMD_HPP
+#define NDARRAYSIMD_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// aligned memory and SIMD kernels used by NdArray
+// the instruction set is the best one enabled at compile time,
+// AVX-512 (-mavx512f), AVX/AVX2 (-mavx2), SSE2 (any x86-64), or plain loops otherwise
+// so one should compile with -march=native to get the widest registers
+// usage:
+//   // memory aligned to simd::alignment bytes
+//   double* p = NdArray::simd::allocate<double>(n);
+//   NdArray::simd::deallocate(p);
+//   // reductions over n items, NaNs are not supported
+//   NdArray::simd::minValue(p, n)
+//   NdArray::simd::maxValue(p, n)
+//   NdArray::simd::argMin(p, n)        // the first index of the min value
+//   NdArray::simd::argMax(p, n)
+//   // a register of doubles, with width items
+//   typedef NdArray::simd::packet<double> P;
+//   P::store(p, P::add(P::load(p), P::set1(1.0)));
+//
+// note:
+//   packet<T> is a register of width 1 (a plain T) if no instruction set is enabled for T,
+//   then packet<T>::enabled is false
+//
+
+namespace NdArray {
+
+    namespace simd {
+
+        // the alignment of the arrays, a cache line and an AVX-512 register
+        const std::size_t alignment = 64;
+
+        // memory for n items aligned to alignment bytes, the items are not initialized
+        // the address returned by malloc is kept just before the aligned block
+        template <typename T>
+        T* allocate(std::size_t n) {
+            if (n > (std::numeric_limits<std::size_t>::max() - alignment - sizeof(void*)) / sizeof(T)) {
+                std::cerr << "Error! The array is too large!" << std::endl;
+                exit(1);
+            }
+            void* raw = std::malloc(n * sizeof(T) + alignment + sizeof(void*));
+            if (raw == nullptr) {
+                std::cerr << "Error! Out of memory!" << std::endl;
+                exit(1);
+            }
+            std::uintptr_t aligned = (std::uintptr_t(raw) + sizeof(void*) + alignment - 1) & ~std::uintptr_t(alignment - 1);
+            reinterpret_cast<void**>(aligned)[-1] = raw;
+            return reinterpret_cast<T*>(aligned);
+        }
+
+        // free the memory got from allocate, nullptr is ignored
+        template <typename T>
+        void deallocate(T* p) {
+            if (p != nullptr) {
+                std::free(reinterpret_cast<void**>(p)[-1]);
+            }
+        }
+
+        // a register of T, the portable fallback holds one item
+        template <typename T>
+        struct packet {
+            typedef T type;
+            static const bool enabled = false;
+            static const int width = 1;
+            static inline type load(const T* p) { return *p; }
+            static inline type loadu(const T* p) { return *p; }
+            static inline void store(T* p, type a) { *p = a; }
+            static inline type set1(T x) { return x; }
+            static inline type add(type a, type b) { return a + b; }
+            static inline type sub(type a, type b) { return a - b; }
+            static inline type mul(type a, type b) { return a * b; }
+            static inline type div(type a, type b) { return a / b; }
+            static inline type min(type a, type b) { return b < a ? b : a; }
+            static inline type max(type a, type b) { return a < b ? b : a; }
+            // bit j is set if item j of a equals item j of b
+            static inline unsigned equalMask(type a, type b) { return a == b ? 1u : 0u; }
+        };
+
+#if defined(__AVX512F__)
+
+        template <>
+        struct packet<double> {
+            typedef __m512d type;
+            static const bool enabled = true;
+            static const int width = 8;
+            static inline type load(const double* p) { return _mm512_load_pd(p); }
+            static inline type loadu(const double* p) { return _mm512_loadu_pd(p); }
+            static inline void store(double* p, type a) { _mm512_store_pd(p, a); }
+            static inline type set1(double x) { return _mm512_set1_pd(x); }
+            static inline type add(type a, type b) { return _mm512_add_pd(a, b); }
+            static inline type sub(type a, type b) { return _mm512_sub_pd(a, b); }
+            static inline type mul(type a, type b) { return _mm512_mul_pd(a, b); }
+            static inline type div(type a, type b) { return _mm512_div_pd(a, b); }
+            static inline type min(type a, type b) { return _mm512_min_pd(a, b); }
+            static inline type max(type a, type b) { return _mm512_max_pd(a, b); }
+            static inline unsigned equalMask(type a, type b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+        };
+
+        template <>
+        struct packet<float> {
+            typedef __m512 type;
+            static const bool enabled = true;
+            static const int width = 16;
+            static inline type load(const float* p) { return _mm512_load_ps(p); }
+            static inline type loadu(const float* p) { return _mm512_loadu_ps(p); }
+            static inline void store(float* p, type a) { _mm512_store_ps(p, a); }
+            static inline type set1(float x) { return _mm512_set1_ps(x); }
+            static inline type add(type a, type b) { return _mm512_add_ps(a, b); }
+            static inline type sub(type a, type b) { return _mm512_sub_ps(a, b); }
+            static inline type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+            static inline type div(type a, type b) { return _mm512_div_ps(a, b); }
+            static inline type min(type a, type b) { return _mm512_min_ps(a, b); }
+            static inline type max(type a, type b) { return _mm512_max_ps(a, b); }
+            static inline unsigned equalMask(type a, type b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+        };
+
+#elif defined(__AVX__)
+
+        // AVX2 adds integer instructions only, the floating-point ones are AVX
+        template <>
+        struct packet<double> {
+            typedef __m256d type;
+            static const bool enabled = true;
+            static const int width = 4;
+            static inline type load(const double* p) { return _mm256_load_pd(p); }
+            static inline type loadu(const double* p) { return _mm256_loadu_pd(p); }
+            static inline void store(double* p, type a) { _mm256_store_pd(p, a); }
+            static inline type set1(double x) { return _mm256_set1_pd(x); }
+            static inline type add(type a, type b) { return _mm256_add_pd(a, b); }
+            static inline type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+            static inline type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+            static inline type div(type a, type b) { return _mm256_div_pd(a, b); }
+            static inline type min(type a, type b) { return _mm256_min_pd(a, b); }
+            static inline type max(type a, type b) { return _mm256_max_pd(a, b); }
+            static inline unsigned equalMask(type a, type b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+        };
+
+        template <>
+        struct packet<float> {
+            typedef __m256 type;
+            static const bool enabled = true;
+            static const int width = 8;
+            static inline type load(const float* p) { return _mm256_load_ps(p); }
+            static inline type loadu(const float* p) { return _mm256_loadu_ps(p); }
+            static inline void store(float* p, type a) { _mm256_store_ps(p, a); }
+            static inline type set1(float x) { return _mm256_set1_ps(x); }
+            static inline type add(type a, type b) { return _mm256_add_ps(a, b); }
+            static inline type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+            static inline type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+            static inline type div(type a, type b) { return _mm256_div_ps(a, b); }
+            static inline type min(type a, type b) { return _mm256_min_ps(a, b); }
+            static inline type max(type a, type b) { return _mm256_max_ps(a, b); }
+            static inline unsigned equalMask(type a, type b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+        };
+
+#elif defined(__SSE2__)
+
+        template <>
+        struct packet<double> {
+            typedef __m128d type;
+            static const bool enabled = true;
+            static const int width = 2;
+            static inline type load(const double* p) { return _mm_load_pd(p); }
+            static inline type loadu(const double* p) { return _mm_loadu_pd(p); }
+            static inline void store(double* p, type a) { _mm_store_pd(p, a); }
+            static inline type set1(double x) { return _mm_set1_pd(x); }
+            static inline type add(type a, type b) { return _mm_add_pd(a, b); }
+            static inline type sub(type a, type b) { return _mm_sub_pd(a, b); }
+            static inline type mul(type a, type b) { return _mm_mul_pd(a, b); }
+            static inline type div(type a, type b) { return _mm_div_pd(a, b); }
+            static inline type min(type a, type b) { return _mm_min_pd(a, b); }
+            static inline type max(type a, type b) { return _mm_max_pd(a, b); }
+            static inline unsigned equalMask(type a, type b) { return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+        };
+
+        template <>
+        struct packet<float> {
+            typedef __m128 type;
+            static const bool enabled = true;
+            static const int width = 4;
+            static inline type load(const float* p) { return _mm_load_ps(p); }
+            static inline type loadu(const float* p) { return _mm_loadu_ps(p); }
+            static inline void store(float* p, type a) { _mm_store_ps(p, a); }
+            static inline type set1(float x) { return _mm_set1_ps(x); }
+            static inline type add(type a, type b) { return _mm_add_ps(a, b); }
+            static inline type sub(type a, type b) { return _mm_sub_ps(a, b); }
+            static inline type mul(type a, type b) { return _mm_mul_ps(a, b); }
+            static inline type div(type a, type b) { return _mm_div_ps(a, b); }
+            static inline type min(type a, type b) { return _mm_min_ps(a, b); }
+            static inline type max(type a, type b) { return _mm_max_ps(a, b); }
+            static inline unsigned equalMask(type a, type b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+        };
+
+#endif
+
+        // the min (isMax = false) or max (isMax = true) of n > 0 items
+        // four registers are reduced in parallel to hide the latency
+        template <bool isMax, typename T>
+        T reduce(const T* data, std::size_t n) {
+
+            typedef packet<T> P;
+            const std::size_t w = P::width;
+            T result = data[0];
+            std::size_t i = 0;
+
+            if (P::enabled && n >= 4 * w) {
+                typename P::type r0 = P::loadu(data);
+                typename P::type r1 = P::loadu(data + w);
+                typename P::type r2 = P::loadu(data + 2 * w);
+                typename P::type r3 = P::loadu(data + 3 * w);
+                for (i = 4 * w; i + 4 * w <= n; i += 4 * w) {
+                    r0 = isMax ? P::max(r0, P::loadu(data + i)) : P::min(r0, P::loadu(data + i));
+                    r1 = isMax ? P::max(r1, P::loadu(data + i + w)) : P::min(r1, P::loadu(data + i + w));
+                    r2 = isMax ? P::max(r2, P::loadu(data + i + 2 * w)) : P::min(r2, P::loadu(data + i + 2 * w));
+                    r3 = isMax ? P::max(r3, P::loadu(data + i + 3 * w)) : P::min(r3, P::loadu(data + i + 3 * w));
+                }
+                r0 = isMax ? P::max(P::max(r0, r1), P::max(r2, r3)) : P::min(P::min(r0, r1), P::min(r2, r3));
+                T items[P::width];
+                std::copy(reinterpret_cast<const T*>(&r0), reinterpret_cast<const T*>(&r0) + w, items);
+                result = isMax ? *std::max_element(items, items + w) : *std::min_element(items, items + w);
+            }
+
+            for (; i < n; i++) {
+                if (isMax ? result < data[i] : data[i] < result) {
+                    result = data[i];
+                }
+            }
+            return result;
+        }
+
+        // the first index of an item equal to value, n if there is none
+        template <typename T>
+        std::size_t find(const T* data, std::size_t n, T value) {
+
+            typedef packet<T> P;
+            const std::size_t w = P::width;
+            std::size_t i = 0;
+
+            if (P::enabled) {
+                typename P::type v = P::set1(value);
+                for (; i + w <= n; i += w) {
+                    unsigned mask = P::equalMask(P::loadu(data + i), v);
+                    if (mask != 0) {
+                        while ((mask & 1u) == 0) {
+                            mask >>= 1;
+                            i++;
+                        }
+                        return i;
+                    }
+                }
+            }
+
+            for (; i < n; i++) {
+                if (data[i] == value) {
+                    return i;
+                }
+            }
+            return n;
+        }
+
+        template <typename T>
+        inline T minValue(const T* data, std::size_t n) {
+            return reduce<false>(data, n);
+        }
+
+        template <typename T>
+        inline T maxValue(const T* data, std::size_t n) {
+            return reduce<true>(data, n);
+        }
+
+        // the min is found first, then its first position
+        template <typename T>
+        inline std::size_t argMin(const T* data, std::size_t n) {
+            return find(data, n, minValue(data, n));
+        }
+
+        template <typename T>
+        inline std::size_t argMax(const T* data, std::size_t n) {
+            return find(data, n, maxValue(data, n));
+        }
+    }
+}
+
+#endif // NDARRAYSIMD_HPP
@@ -0,0 +1,251 @@
+#ifndef BARRIERTREE_HPP
+#define BARRIERTREE_HPP
+
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "gridIndex.hpp"
+#include "mergeTree.hpp"
+#include "pmfParser.hpp"
+#include "searchState.hpp"
+
+// an index of the barriers between all the points of a pmf
+// it is built once, then the highest barrier along the lowest-barrier pathway
+// between any two points is found in O(log n)
+// Usage:
+//   // T is the storage type of the pmf, the barriers are decoded energies
+//   auto index = barrierTree<T>(pmfData, pbc)
+//   // the barrier between two points
+//   index.getBarrier(initialPoint, endPoint)
+//   // all the cells (linear indices) connected to the two points below the barrier,
+//   // the lowest-barrier pathway lies inside this basin
+//   std::vector<std::int64_t> cells
+//   index.getBasin(initialPoint, endPoint, cells)
+//
+// note:
+//   the cells are merged in the order of their energies, as in mergeTree.
+//   Each merge creates a node of a tree (disconnectivity graph) whose leaves are the cells,
+//   and the barrier between two cells is the energy of their lowest common ancestor.
+//   If the leaves are listed in depth-first order, this is the maximum of
+//   the barriers between neighbouring leaves in the range between the two cells,
+//   so only the leaf order and a range-maximum tree of these barriers are stored.
+//
+
+namespace barrierTree {
+
+    template <typename T = double>
+    class barrierTree {
+
+    public:
+
+        // constructor, build the index
+        barrierTree(const pmfParser::pmf<T>& pmfData, const std::vector<bool>& pbc) {
+
+            assert(pbc.size() == static_cast<std::size_t>(pmfData.getDimension()));
+
+            this->pmfData = &pmfData;
+            this->grid = gridIndex::gridIndex(pmfData.getShape(), pbc);
+            this->energy = pmfData.getPmfData().getCArray();
+            this->totalSize = this->grid.getTotalSize();
+
+            this->build();
+        }
+
+        // the highest energy along the lowest-barrier pathway between two points
+        double getBarrier(const std::vector<double>& initialPoint, const std::vector<double>& endPoint) const {
+            return this->getBarrier(this->toIndex(initialPoint), this->toIndex(endPoint));
+        }
+
+        // the same, using linear indices
+        double getBarrier(std::int64_t a, std::int64_t b) const {
+            if (a == b) {
+                return this->pmfData->energy(a);
+            }
+            std::int64_t first = std::min(this->position[a], this->position[b]);
+            std::int64_t last = std::max(this->position[a], this->position[b]);
+            return this->rangeMax(first, last);
+        }
+
+        // all the cells connected to the two points through cells not higher than the barrier
+        void getBasin(const std::vector<double>& initialPoint, const std::vector<double>& endPoint, std::vector<std::int64_t>& cells) const {
+            this->getBasin(this->toIndex(initialPoint), this->toIndex(endPoint), cells);
+        }
+
+        // the same, using linear indices
+        void getBasin(std::int64_t a, std::int64_t b, std::vector<std::int64_t>& cells) const {
+
+            double barrier = this->getBarrier(a, b);
+
+            // the basin is a contiguous range of the leaf order
+            std::int64_t first = std::min(this->position[a], this->position[b]);
+            std::int64_t last = std::max(this->position[a], this->position[b]);
+            while (first > 0 && this->gap(first - 1) <= barrier) {
+                first--;
+            }
+            while (last < this->totalSize - 1 && this->gap(last) <= barrier) {
+                last++;
+            }
+
+            cells = std::vector<std::int64_t>(this->leafOrder.begin() + first, this->leafOrder.begin() + last + 1);
+        }
+
+    private:
+
+        // linear index of a point
+        std::int64_t toIndex(const std::vector<double>& point) const {
+            return this->grid.toIndex(this->pmfData->RCToInternal(point));
+        }
+
+        // the barrier between leaf i and leaf i + 1
+        inline double gap(std::int64_t i) const {
+            return this->gapTree[this->gapNum + i];
+        }
+
+        // the maximum of gap(first) ... gap(last - 1)
+        double rangeMax(std::int64_t first, std::int64_t last) const {
+            double maxN = -std::numeric_limits<double>::infinity();
+            for (first += this->gapNum, last += this->gapNum; first < last; first /= 2, last /= 2) {
+                if (first & 1) {
+                    maxN = std::max(maxN, this->gapTree[first++]);
+                }
+                if (last & 1) {
+                    maxN = std::max(maxN, this->gapTree[--last]);
+                }
+            }
+            return maxN;
+        }
+
+        // the root of the merged cells containing a point, with path halving
+        std::int64_t root(std::vector<std::int64_t>& father, std::int64_t point) const {
+            while (father[point] != point) {
+                father[point] = father[father[point]];
+                point = father[point];
+            }
+            return point;
+        }
+
+        void build() {
+
+            std::int64_t n = this->totalSize;
+            auto order = mergeTree::sortCells(this->energy, n);
+
+            // the tree, cells are nodes 0 ... n-1, merges are nodes n ... nodeNum-1
+            // a node is always created after its children
+            std::vector<std::int64_t> nodeFather(2 * n, -1);
+            std::vector<double> nodeEnergy(n);
+            std::int64_t nodeNum = n;
+
+            // the merged cells, and the tree node on top of each group of merged cells
+            std::vector<std::int64_t> father(n);
+            std::vector<std::int64_t> top(n);
+            for (std::int64_t i = 0; i < n; i++) {
+                father[i] = i;
+                top[i] = i;
+            }
+            searchState::bitSet merged(n);
+
+            std::vector<std::int64_t> roots;
+            for (std::int64_t p:order) {
+                merged.set(p);
+                roots.clear();
+                for (int i = 0; i < this->grid.getDimension(); i++) {
+                    for (int side = -1; side <= 1; side += 2) {
+                        std::int64_t q = this->grid.neighbour(p, i, side);
+                        if (q == -1 || !merged.test(q)) {
+                            continue;
+                        }
+                        std::int64_t r = this->root(father, q);
+                        if (r != p && std::find(roots.begin(), roots.end(), r) == roots.end()) {
+                            roots.push_back(r);
+                        }
+                    }
+                }
+                if (roots.size() == 0) {
+                    continue;
+                }
+                // the groups of cells meet at the energy of p
+                std::int64_t node = nodeNum++;
+                nodeEnergy[node - n] = this->pmfData->energy(p);
+                nodeFather[p] = node;
+                for (std::int64_t r:roots) {
+                    nodeFather[top[r]] = node;
+                    father[r] = p;
+                }
+                top[p] = node;
+            }
+
+            father = {};
+            top = {};
+
+            // number of leaves below each node
+            std::vector<std::int64_t> count(nodeNum, 0);
+            for (std::int64_t i = 0; i < n; i++) {
+                count[i] = 1;
+            }
+            for (std::int64_t i = 0; i < nodeNum; i++) {
+                if (nodeFather[i] != -1) {
+                    count[nodeFather[i]] += count[i];
+                }
+            }
+
+            // the first leaf position below each node, assigned from top to bottom
+            // the gap between two children of a node is the energy of the node
+            this->gapNum = n - 1;
+            this->gapTree = std::vector<double>(2 * this->gapNum, 0);
+            std::vector<std::int64_t> start(nodeNum, 0);
+            std::vector<std::int64_t> next(nodeNum, 0);
+            std::int64_t rootStart = 0;
+            for (std::int64_t i = nodeNum - 1; i >= 0; i--) {
+                std::int64_t f = nodeFather[i];
+                if (f == -1) {
+                    // disconnected parts of the grid are separated by an infinite barrier
+                    start[i] = rootStart;
+                    if (rootStart > 0) {
+                        this->gapTree[this->gapNum + rootStart - 1] = std::numeric_limits<double>::infinity();
+                    }
+                    rootStart += count[i];
+                }
+                else {
+                    start[i] = next[f];
+                    if (next[f] > start[f]) {
+                        this->gapTree[this->gapNum + next[f] - 1] = nodeEnergy[f - n];
+                    }
+                    next[f] += count[i];
+                }
+                next[i] = start[i];
+            }
+
+            this->position = std::vector<std::int64_t>(start.begin(), start.begin() + n);
+            this->leafOrder = std::vector<std::int64_t>(n);
+            for (std::int64_t i = 0; i < n; i++) {
+                this->leafOrder[this->position[i]] = i;
+            }
+
+            // range-maximum tree of the gaps
+            for (std::int64_t i = this->gapNum - 1; i > 0; i--) {
+                this->gapTree[i] = std::max(this->gapTree[2 * i], this->gapTree[2 * i + 1]);
+            }
+        }
+
+        // the pmf data
+        const pmfParser::pmf<T>* pmfData;
+        // linear indices of the grid cells
+        gridIndex::gridIndex grid;
+        // the energies of the pmf as stored, indexed by linear index
+        const T* energy;
+        std::int64_t totalSize;
+
+        // cells in depth-first order of the tree, and the position of each cell in this order
+        std::vector<std::int64_t> leafOrder;
+        std::vector<std::int64_t> position;
+        // barriers between neighbouring leaves in gapTree[gapNum ...]
+        // and their range maxima in gapTree[1 ... gapNum - 1]
+        std::int64_t gapNum;
+        std::vector<double> gapTree;
+    };
+}
+
+#endif // BARRIERTREE_HPP
@@ -0,0 +1,96 @@
+// benchmark of NdArray lookups on a 4-D grid
+// compile and run from the root of the repository, for instance
+//   g++ -O2 -I. benchmark/ndArrayLookup.cpp -o ndArrayLookup
+//   ./ndArrayLookup
+//
+// the same random points are read
+//   by the former position(), which recomputed the strides for each lookup (O(D^2)),
+//   by operator[] with the strides cached in the NdArray,
+//   and by flat() with linear indices computed beforehand
+//
+// five runs with g++ 12.2 -O2 on one core of an Intel Xeon (Linux) gave
+//   nested 40-45 ns, cached 32-38 ns, flat 15-18 ns per lookup,
+//   so about 1.1-1.3x for the cached strides and 2.4-2.9x for flat()
+// the lookups are bound by cache misses on the 42 MB array, so the figures vary from run to run
+//
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "array/NdArray.hpp"
+
+// the position of a point as computed before the strides were cached
+std::size_t nestedPosition(const std::vector<int>& shape, const std::vector<int>& pos) {
+    std::size_t realPos = 0;
+    std::size_t tempSum = 0;
+    for (std::size_t i = 0; i < pos.size(); i++) {
+        tempSum = pos[i];
+        for (std::size_t j = i + 1; j < pos.size(); j++) {
+            tempSum *= shape[j];
+        }
+        realPos += tempSum;
+    }
+    return realPos;
+}
+
+// run a lookup function over all the points, return ns per lookup
+template <typename F>
+double timeLookups(const char* name, std::size_t num, F lookup) {
+    double sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < num; i++) {
+        sum += lookup(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / num;
+    // print the sum so that the lookups are not optimized away
+    std::cout << name << ns << " ns/lookup (checksum " << sum << ")" << std::endl;
+    return ns;
+}
+
+int main() {
+
+    const std::vector<int> shape = {48, 48, 48, 48};
+    // each point is read rounds times
+    const std::size_t pointNum = 1000000;
+    const std::size_t rounds = 20;
+    const std::size_t lookupNum = pointNum * rounds;
+
+    NdArray::NdArray<double> arr(shape);
+    for (std::size_t i = 0; i < arr.getTotalSize(); i++) {
+        arr.flat(i) = double(i % 1000) * 0.001;
+    }
+
+    // random points, and their linear indices
+    std::mt19937 gen(2626);
+    std::vector<std::vector<int> > points(pointNum, std::vector<int>(shape.size()));
+    std::vector<std::size_t> indices(pointNum);
+    for (std::size_t i = 0; i < pointNum; i++) {
+        for (std::size_t d = 0; d < shape.size(); d++) {
+            points[i][d] = std::uniform_int_distribution<int>(0, shape[d] - 1)(gen);
+        }
+        indices[i] = nestedPosition(shape, points[i]);
+    }
+
+    const double* data = arr.getCArray();
+    const NdArray::NdArray<double>& constArr = arr;
+
+    std::cout << "4-D grid " << shape[0] << "^4, " << lookupNum << " random lookups" << std::endl;
+    double nested = timeLookups("nested position:  ", lookupNum, [&](std::size_t i) {
+        return data[nestedPosition(shape, points[i % pointNum])];
+    });
+    double cached = timeLookups("cached strides:   ", lookupNum, [&](std::size_t i) {
+        return constArr[points[i % pointNum]];
+    });
+    double flat = timeLookups("flat index:       ", lookupNum, [&](std::size_t i) {
+        return constArr.flat(indices[i % pointNum]);
+    });
+
+    std::cout << "speedup of cached strides: " << nested / cached << std::endl;
+    std::cout << "speedup of flat index:     " << nested / flat << std::endl;
+
+    return 0;
+}
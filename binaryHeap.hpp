@@ -0,0 +1,137 @@
+#ifndef BINARYHEAP_HPP
+#define BINARYHEAP_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// a binary min-heap used as the open list of the path finders
+// items with the same key are popped in the order they were pushed,
+// which reproduces the behaviour of a linear scan over an unsorted list
+// usage:
+//   binaryHeap<std::vector<int> > heap;
+//   heap.push({0,0}, 1.5);
+//   heap.push({0,1}, 0.5);
+//   heap.top()       // {0,1}
+//   heap.topKey()    // 0.5
+//   auto p = heap.pop()
+//   heap.size()
+//   heap.empty()
+//   heap.clear()
+//
+
+namespace binaryHeap {
+
+    // min-heap of items keyed by K, ties are broken by insertion order
+    template <typename T, typename K = double>
+    class binaryHeap {
+
+    public:
+
+        binaryHeap() : pushCount(0) {}
+
+        // add an item with a given key, O(log n)
+        void push(const T& item, K key) {
+            this->heap.push_back(node{key, this->pushCount++, item});
+            this->siftUp(this->heap.size() - 1);
+        }
+
+        // the item with the lowest key
+        const T& top() const {
+            assert(this->heap.size() != 0);
+            return this->heap[0].item;
+        }
+
+        // the lowest key
+        K topKey() const {
+            assert(this->heap.size() != 0);
+            return this->heap[0].key;
+        }
+
+        // remove the item with the lowest key and return it, O(log n)
+        T pop() {
+            assert(this->heap.size() != 0);
+            T minItem = std::move(this->heap[0].item);
+            this->heap[0] = std::move(this->heap.back());
+            this->heap.pop_back();
+            if (this->heap.size() != 0) {
+                this->siftDown(0);
+            }
+            return minItem;
+        }
+
+        std::size_t size() const {
+            return this->heap.size();
+        }
+
+        bool empty() const {
+            return this->heap.size() == 0;
+        }
+
+        void clear() {
+            this->heap.clear();
+            this->pushCount = 0;
+        }
+
+    private:
+
+        struct node {
+            K key;
+            // when the item was pushed, used for tie-breaking
+            std::uint64_t order;
+            T item;
+        };
+
+        // whether node a should be popped before node b
+        static bool before(const node& a, const node& b) {
+            if (a.key < b.key) {
+                return true;
+            }
+            if (b.key < a.key) {
+                return false;
+            }
+            return a.order < b.order;
+        }
+
+        void siftUp(std::size_t pos) {
+            node n = std::move(this->heap[pos]);
+            while (pos > 0) {
+                std::size_t parent = (pos - 1) / 2;
+                if (!before(n, this->heap[parent])) {
+                    break;
+                }
+                this->heap[pos] = std::move(this->heap[parent]);
+                pos = parent;
+            }
+            this->heap[pos] = std::move(n);
+        }
+
+        void siftDown(std::size_t pos) {
+            std::size_t size = this->heap.size();
+            node n = std::move(this->heap[pos]);
+            while (true) {
+                std::size_t child = 2 * pos + 1;
+                if (child >= size) {
+                    break;
+                }
+                if (child + 1 < size && before(this->heap[child + 1], this->heap[child])) {
+                    child++;
+                }
+                if (!before(this->heap[child], n)) {
+                    break;
+                }
+                this->heap[pos] = std::move(this->heap[child]);
+                pos = child;
+            }
+            this->heap[pos] = std::move(n);
+        }
+
+        // the heap itself, heap[0] is the minimum
+        std::vector<node> heap;
+        // total number of pushes, used as a tie-breaker
+        std::uint64_t pushCount;
+    };
+}
+
+#endif // BINARYHEAP_HPP
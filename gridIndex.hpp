@@ -0,0 +1,389 @@
+#ifndef GRIDINDEX_HPP
+#define GRIDINDEX_HPP
+
+#include <cstdlib>
+#include <cstdint>
+#include <cassert>
+#include <array>
+#include <bitset>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "searchState.hpp"
+#include "array/NdArray.hpp"
+
+// linear (row-major) indices of the cells of a grid
+// usage:
+//   auto g = gridIndex({180,180}, {true,true});
+//   auto i = g.toIndex({3,4})
+//   g.toPoint(i)                        // {3,4}
+//   g.coordinate(i, 1)                  // 4
+//   g.neighbour(i, 0, -1)               // index of {2,4}, -1 if there is none
+//   std::vector<std::int64_t> adjacentPoints;
+//   g.findAdjacentPoints(i, adjacentPoints)
+//   // without allocation, into a buffer of at least 2 * dimension points,
+//   // compiled for a given dimension, 0 means any dimension
+//   std::int64_t buffer[4];
+//   int num = g.findAdjacentPoints<2>(i, buffer)
+//   // a padded grid, each axis has one more cell on both sides
+//   // the linear indices then address the padded layout
+//   auto h = gridIndex({180,180}, {true,false}, true);
+//   h.getIndexSize()                    // 182 * 182 + 1
+//   h.getWall()                         // the cell beyond a non-periodic boundary
+//   h.resolve(j)                        // the cell a halo index stands for, -1 for the wall
+//   h.toCell(i)                         // row-major position of i in the unpadded grid
+//   h.fromCell(c)                       // and back
+//
+
+namespace gridIndex {
+
+    // the offset stored when a point has no neighbour on one side
+    const std::int64_t noNeighbour = std::numeric_limits<std::int64_t>::min();
+
+    class gridIndex {
+
+    public:
+
+        gridIndex() : dimension(0), totalSize(0), pad(0), indexSize(0), wall(-1) {}
+
+        // if padded, the linear indices address a grid with a halo of one cell around each axis
+        // a halo cell beyond a periodic boundary stands for the cell on the other side,
+        // and those beyond a non-periodic boundary stand for a single wall cell,
+        // so that the neighbours of every cell are found without boundary checks
+        gridIndex(const std::vector<int>& shape, const std::vector<bool>& pbc, bool padded = false) {
+            this->shape = shape;
+            this->pbc = pbc;
+            this->dimension = shape.size();
+            this->pad = padded ? 1 : 0;
+            this->indexShape = shape;
+            for (auto& s:this->indexShape) {
+                s += 2 * this->pad;
+            }
+            this->strides = std::vector<std::int64_t>(this->dimension, 1);
+            for (int i = this->dimension - 2; i >= 0; i--) {
+                this->strides[i] = this->strides[i + 1] * this->indexShape[i + 1];
+            }
+            // the padded grid is larger, so its size is the one checked against overflow
+            NdArray::shapeProduct(this->indexShape);
+            this->totalSize = this->dimension == 0 ? 0 : std::int64_t(NdArray::shapeProduct(this->shape));
+            this->indexSize = this->totalSize;
+            this->wall = -1;
+
+            if (padded) {
+                // the wall is the last index, after the padded grid
+                this->wall = this->strides[0] * this->indexShape[0];
+                this->indexSize = this->wall + 1;
+                this->buildEdges();
+                return;
+            }
+
+            // the offsets to the left and right neighbours at each coordinate of each axis
+            // only the ends of an axis differ from -stride and +stride
+            this->axisStart = std::vector<std::int64_t>(this->dimension, 0);
+            this->offsets.clear();
+            for (int i = 0; i < this->dimension; i++) {
+                this->axisStart[i] = this->offsets.size();
+                for (int coor = 0; coor < this->shape[i]; coor++) {
+                    if (coor > 0) {
+                        this->offsets.push_back(-this->strides[i]);
+                    }
+                    else {
+                        this->offsets.push_back(this->pbc[i] ? (this->shape[i] - 1) * this->strides[i] : noNeighbour);
+                    }
+                    if (coor < this->shape[i] - 1) {
+                        this->offsets.push_back(this->strides[i]);
+                    }
+                    else {
+                        this->offsets.push_back(this->pbc[i] ? -coor * this->strides[i] : noNeighbour);
+                    }
+                }
+            }
+        }
+
+        // linear index of an internal coordinate
+        std::int64_t toIndex(const std::vector<int>& point) const {
+            std::int64_t index = 0;
+            for (int i = 0; i < this->dimension; i++) {
+                index += (point[i] + this->pad) * this->strides[i];
+            }
+            return index;
+        }
+
+        // internal coordinate of a linear index
+        std::vector<int> toPoint(std::int64_t index) const {
+            std::vector<int> point(this->dimension);
+            for (int i = 0; i < this->dimension; i++) {
+                point[i] = this->coordinate(index, i);
+            }
+            return point;
+        }
+
+        // the internal coordinate of a linear index along one dimension
+        inline int coordinate(std::int64_t index, int dim) const {
+            return int((index / this->strides[dim]) % this->indexShape[dim]) - this->pad;
+        }
+
+        // the row-major position in the unpadded grid of a linear index
+        // the same as the index if the grid is not padded
+        std::int64_t toCell(std::int64_t index) const {
+            if (!this->pad) {
+                return index;
+            }
+            std::int64_t cell = 0;
+            for (int i = 0; i < this->dimension; i++) {
+                cell = cell * this->shape[i] + this->coordinate(index, i);
+            }
+            return cell;
+        }
+
+        // the linear index of a row-major position in the unpadded grid
+        std::int64_t fromCell(std::int64_t cell) const {
+            if (!this->pad) {
+                return cell;
+            }
+            std::int64_t index = 0;
+            for (int i = this->dimension - 1; i >= 0; i--) {
+                index += (cell % this->shape[i] + 1) * this->strides[i];
+                cell /= this->shape[i];
+            }
+            return index;
+        }
+
+        // the adjacent point of a point along dimension dim
+        // side = -1 (left) or 1 (right)
+        // return -1 if there is no such point
+        inline std::int64_t neighbour(std::int64_t point, int dim, int side) const {
+            if (this->pad) {
+                return this->resolve(point + side * this->strides[dim]);
+            }
+            std::int64_t offset = this->offset(dim, this->coordinate(point, dim), side);
+            return offset == noNeighbour ? -1 : point + offset;
+        }
+
+        // the linear index of the cell a padded index stands for, -1 if it is the wall
+        std::int64_t resolve(std::int64_t index) const {
+            assert(this->pad);
+            if (index == this->wall) {
+                return -1;
+            }
+            std::int64_t target = 0;
+            for (int i = 0; i < this->dimension; i++) {
+                int coor = this->coordinate(index, i);
+                if (coor < 0 || coor >= this->shape[i]) {
+                    if (!this->pbc[i]) {
+                        return -1;
+                    }
+                    coor = (coor + this->shape[i]) % this->shape[i];
+                }
+                target += (coor + 1) * this->strides[i];
+            }
+            return target;
+        }
+
+        // find the adjacent points of the input point,
+        // write them into adjacentPoints as linear indices
+        // the order is left and right side of dimension 0, 1, ...
+        void findAdjacentPoints(std::int64_t point, std::vector<std::int64_t>& adjacentPoints) const {
+            adjacentPoints.resize(2 * this->dimension);
+            adjacentPoints.resize(this->findAdjacentPoints<0>(point, adjacentPoints.data()));
+            if (this->pad) {
+                adjacentPoints.erase(std::remove(adjacentPoints.begin(), adjacentPoints.end(), this->wall), adjacentPoints.end());
+            }
+        }
+
+        // the same, written into a buffer of at least 2 * dimension points
+        // return the number of adjacent points
+        // D is the dimension known at compile time, the loops then have a fixed trip count
+        // D = 0 works for any dimension
+        // on a padded grid, all the 2 * dimension neighbours are written without any check,
+        // those beyond a non-periodic boundary are the wall, which the caller should skip
+        template <int D>
+        int findAdjacentPoints(std::int64_t point, std::int64_t* adjacentPoints) const {
+
+            assert(D == 0 || D == this->dimension);
+            const int dimension = (D > 0) ? D : this->dimension;
+
+            if (this->pad) {
+                // the neighbours of an interior cell are never in the halo
+                if (!this->edge->test(point)) {
+                    for (int i = 0; i < dimension; i++) {
+                        adjacentPoints[2 * i] = point - this->strides[i];
+                        adjacentPoints[2 * i + 1] = point + this->strides[i];
+                    }
+                }
+                else {
+                    const std::int64_t* n = &((*this->edgeNeighbours)[2 * dimension * this->edgeRank(point)]);
+                    for (int i = 0; i < 2 * dimension; i++) {
+                        adjacentPoints[i] = n[i];
+                    }
+                }
+                return 2 * dimension;
+            }
+
+            // the coordinates, from the last dimension to the first
+            std::array<int, (D > 0 ? D : maxDimension)> coor;
+            std::vector<int> generalCoor;
+            int* c = coor.data();
+            if (D == 0 && dimension > maxDimension) {
+                generalCoor.resize(dimension);
+                c = generalCoor.data();
+            }
+            std::int64_t rest = point;
+            for (int i = dimension - 1; i >= 0; i--) {
+                c[i] = int(rest % this->shape[i]);
+                rest /= this->shape[i];
+            }
+
+            int num = 0;
+            for (int i = 0; i < dimension; i++) {
+                const std::int64_t* o = &(this->offsets[this->axisStart[i] + 2 * c[i]]);
+                if (o[0] != noNeighbour) {
+                    adjacentPoints[num++] = point + o[0];
+                }
+                if (o[1] != noNeighbour) {
+                    adjacentPoints[num++] = point + o[1];
+                }
+            }
+
+            if (num == 0) {
+                std::cerr << "Error! No adjacent point is found!" << std::endl;
+                exit(1);
+            }
+            return num;
+        }
+
+        int getDimension() const {
+            return this->dimension;
+        }
+
+        // the number of cells of the grid
+        std::int64_t getTotalSize() const {
+            return this->totalSize;
+        }
+
+        // the number of linear indices, including the halo and the wall if padded
+        std::int64_t getIndexSize() const {
+            return this->indexSize;
+        }
+
+        bool isPadded() const {
+            return this->pad != 0;
+        }
+
+        // the linear index of the wall, -1 if not padded
+        std::int64_t getWall() const {
+            return this->wall;
+        }
+
+        const std::vector<int>& getShape() const {
+            return this->shape;
+        }
+
+        // the shape of the index space, shape + 2 on each axis if padded
+        const std::vector<int>& getIndexShape() const {
+            return this->indexShape;
+        }
+
+        const std::vector<std::int64_t>& getStrides() const {
+            return this->strides;
+        }
+
+        const std::vector<bool>& getPbc() const {
+            return this->pbc;
+        }
+
+    private:
+
+        // the offset from a point at coordinate coor of axis dim to its neighbour on one side
+        inline std::int64_t offset(int dim, int coor, int side) const {
+            return this->offsets[this->axisStart[dim] + 2 * coor + (side > 0 ? 1 : 0)];
+        }
+
+        // the neighbours of the cells next to the halo, 2 * dimension for each of them,
+        // the halo indices resolved to the cells they stand for or to the wall
+        // the other indices need no table, their neighbours are at -stride and +stride
+        void buildEdges() {
+            std::int64_t paddedSize = this->wall;
+            std::shared_ptr<searchState::bitSet> edgeCells = std::make_shared<searchState::bitSet>(paddedSize);
+            for (std::int64_t index = 0; index < paddedSize; index++) {
+                bool inside = true;
+                bool atEdge = false;
+                for (int i = 0; i < this->dimension; i++) {
+                    int coor = this->coordinate(index, i);
+                    if (coor < 0 || coor >= this->shape[i]) {
+                        inside = false;
+                        break;
+                    }
+                    if (coor == 0 || coor == this->shape[i] - 1) {
+                        atEdge = true;
+                    }
+                }
+                if (inside && atEdge) {
+                    edgeCells->set(index);
+                }
+            }
+
+            std::vector<std::int64_t> ranks(edgeCells->wordNum());
+            std::vector<std::int64_t> neighbours;
+            std::int64_t count = 0;
+            for (std::size_t w = 0; w < ranks.size(); w++) {
+                ranks[w] = count;
+                count += std::bitset<64>(edgeCells->word(w)).count();
+            }
+            neighbours.reserve(2 * this->dimension * count);
+            for (std::int64_t index = 0; index < paddedSize; index++) {
+                if (!edgeCells->test(index)) {
+                    continue;
+                }
+                for (int i = 0; i < this->dimension; i++) {
+                    std::int64_t left = this->resolve(index - this->strides[i]);
+                    std::int64_t right = this->resolve(index + this->strides[i]);
+                    neighbours.push_back(left == -1 ? this->wall : left);
+                    neighbours.push_back(right == -1 ? this->wall : right);
+                }
+            }
+            this->edge = edgeCells;
+            this->edgeWordRanks = std::make_shared<const std::vector<std::int64_t> >(std::move(ranks));
+            this->edgeNeighbours = std::make_shared<const std::vector<std::int64_t> >(std::move(neighbours));
+        }
+
+        // the position of an edge cell among all the edge cells
+        inline std::int64_t edgeRank(std::int64_t point) const {
+            std::uint64_t below = this->edge->word(point >> 6) & ((std::uint64_t(1) << (point & 63)) - 1);
+            return (*this->edgeWordRanks)[point >> 6] + std::int64_t(std::bitset<64>(below).count());
+        }
+
+        // dimensions whose coordinates are decoded on the stack by the generic findAdjacentPoints
+        static constexpr int maxDimension = 8;
+
+        // shape of the grid, shape of the (padded) index space
+        // and row-major strides of each dimension in the index space
+        std::vector<int> shape;
+        std::vector<int> indexShape;
+        std::vector<std::int64_t> strides;
+        // whether periodic for each dimension
+        std::vector<bool> pbc;
+        int dimension;
+        std::int64_t totalSize;
+        // offsets to the left and right neighbours,
+        // offsets[axisStart[dim] + 2 * coor] and offsets[axisStart[dim] + 2 * coor + 1]
+        std::vector<std::int64_t> axisStart;
+        std::vector<std::int64_t> offsets;
+        // below are used if padded
+        // width of the halo, 0 or 1
+        int pad;
+        std::int64_t indexSize;
+        std::int64_t wall;
+        // the cells with a neighbour in the halo, shared by the copies of the gridIndex
+        std::shared_ptr<const searchState::bitSet> edge;
+        // the number of edge cells before each word of edge
+        std::shared_ptr<const std::vector<std::int64_t> > edgeWordRanks;
+        // the neighbours of the edge cells, in the order of their indices
+        std::shared_ptr<const std::vector<std::int64_t> > edgeNeighbours;
+    };
+}
+
+#endif // GRIDINDEX_HPP
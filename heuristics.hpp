@@ -0,0 +1,120 @@
+#ifndef HEURISTICS_HPP
+#define HEURISTICS_HPP
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "gridIndex.hpp"
+
+// heuristics h(x) added to the energies by the path finders (A-star alg)
+// a heuristic is any type with a method
+//   double operator()(std::int64_t point) const
+// where point is a linear index of the grid searched by the path finder,
+// path.getGrid(), whose coordinate along dimension dim is grid.coordinate(point, dim)
+// the type is a template parameter of the search, so the call is inlined
+// usage:
+//   // no heuristic, the same as path.Dijkstra()
+//   path.Dijkstra(heuristics::none())
+//   // k * the euclidean distance (in grid points) to a point
+//   path.Dijkstra(heuristics::euclidean(path.getGrid(), pmfData.RCToInternal({20,1.0}), 0.1))
+//   // a harmonic well k[i] * d[i]^2 around a point
+//   path.Dijkstra(heuristics::harmonic(path.getGrid(), pmfData.RCToInternal({20,1.0}), {0.1,0.1}))
+//   // or one's own
+//   struct myHeuristic {
+//       double operator()(std::int64_t point) const { ... }
+//   };
+//   path.Dijkstra(myHeuristic())
+//
+// note:
+//   the heuristics keep a reference to the grid, so they must not outlive the path finder
+//
+
+namespace heuristics {
+
+    // no heuristic, the search then only reads the energies
+    struct none {
+        inline double operator()(std::int64_t) const {
+            return 0;
+        }
+    };
+
+    // the distances (in grid points) between a point and a center along each dimension,
+    // the shortest image is used for periodic dimensions
+    class distanceToCenter {
+
+    public:
+
+        distanceToCenter(const gridIndex::gridIndex& grid, const std::vector<int>& center) {
+            assert(center.size() == static_cast<std::size_t>(grid.getDimension()));
+            this->grid = &grid;
+            this->center = center;
+        }
+
+        inline int distance(std::int64_t point, int dim) const {
+            int d = std::abs(this->grid->coordinate(point, dim) - this->center[dim]);
+            if (this->grid->getPbc()[dim]) {
+                int size = this->grid->getShape()[dim];
+                if (size - d < d) {
+                    d = size - d;
+                }
+            }
+            return d;
+        }
+
+    protected:
+
+        const gridIndex::gridIndex* grid;
+        std::vector<int> center;
+    };
+
+    // forceConstant * the euclidean distance to a point
+    class euclidean : public distanceToCenter {
+
+    public:
+
+        euclidean(const gridIndex::gridIndex& grid, const std::vector<int>& center, double forceConstant)
+            : distanceToCenter(grid, center), forceConstant(forceConstant) {}
+
+        inline double operator()(std::int64_t point) const {
+            double sum = 0;
+            for (int i = 0; i < this->grid->getDimension(); i++) {
+                double d = this->distance(point, i);
+                sum += d * d;
+            }
+            return this->forceConstant * std::sqrt(sum);
+        }
+
+    private:
+
+        double forceConstant;
+    };
+
+    // sum of forceConstants[i] * d[i]^2, a harmonic well around a point
+    class harmonic : public distanceToCenter {
+
+    public:
+
+        harmonic(const gridIndex::gridIndex& grid, const std::vector<int>& center, const std::vector<double>& forceConstants)
+            : distanceToCenter(grid, center), forceConstants(forceConstants) {
+            assert(forceConstants.size() == static_cast<std::size_t>(grid.getDimension()));
+        }
+
+        inline double operator()(std::int64_t point) const {
+            double sum = 0;
+            for (int i = 0; i < this->grid->getDimension(); i++) {
+                double d = this->distance(point, i);
+                sum += this->forceConstants[i] * d * d;
+            }
+            return sum;
+        }
+
+    private:
+
+        std::vector<double> forceConstants;
+    };
+}
+
+#endif // HEURISTICS_HPP
@@ -0,0 +1,371 @@
+#ifndef MERGETREE_HPP
+#define MERGETREE_HPP
+
+#include <cstdlib>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "gridIndex.hpp"
+#include "pmfParser.hpp"
+#include "quantization.hpp"
+#include "searchState.hpp"
+
+// find the lowest-barrier (minimax) pathway connecting two points on a pmf
+// by merging the cells of the grid in the order of their energies (Kruskal alg)
+// the sorted cells and the union-find forest are kept,
+// so the same object can answer many queries on the same pmf
+// Usage:
+//   // T is the storage type of the pmf, only the reported energies are decoded
+//   auto tree = mergeTree<T>(pmfData, pbc)
+//   tree.query(initialPoint, endPoint)
+//   // the highest energy along the pathway
+//   tree.getBarrier()
+//   // get results, same as pathFinder
+//   tree.getResults(trajectory, energyResults)
+//   tree.getExploredPoints(pointList)
+//   tree.getExploredPointNum()
+//
+
+namespace mergeTree {
+
+    // cells sorted by energy, equal energies are sorted by index
+    // the stored values of a pmf are sorted as the energies
+    template <typename T>
+    std::vector<std::int64_t> sortCells(const T* energy, std::int64_t totalSize) {
+        std::vector<std::int64_t> order(totalSize);
+        std::iota(order.begin(), order.end(), std::int64_t(0));
+        std::sort(order.begin(), order.end(), [energy](std::int64_t a, std::int64_t b) {
+            return energy[a] < energy[b] || (!(energy[b] < energy[a]) && a < b);
+        });
+        return order;
+    }
+
+    template <typename T = double>
+    class mergeTree {
+
+    public:
+
+        // constructor, sort all the cells by energy
+        mergeTree(const pmfParser::pmf<T>& pmfData, const std::vector<bool>& pbc) {
+
+            assert(pbc.size() == static_cast<std::size_t>(pmfData.getDimension()));
+
+            this->pmfData = &pmfData;
+            this->grid = gridIndex::gridIndex(pmfData.getShape(), pbc);
+            this->energy = pmfData.getPmfData().getCArray();
+            this->dimension = pmfData.getDimension();
+
+            std::int64_t totalSize = this->grid.getTotalSize();
+
+            this->order = sortCells(this->energy, totalSize);
+            this->step = std::vector<std::int64_t>(totalSize);
+            for (std::int64_t i = 0; i < totalSize; i++) {
+                this->step[this->order[i]] = i;
+            }
+
+            // an empty forest
+            this->father = std::vector<std::int64_t>(totalSize);
+            std::iota(this->father.begin(), this->father.end(), std::int64_t(0));
+            this->linkStep = std::vector<std::int64_t>(totalSize, 0);
+            this->treeRank = std::vector<unsigned char>(totalSize, 0);
+            this->treeEdges.resize(totalSize * 2 * this->dimension);
+            this->mergedNum = 0;
+
+            this->state.resize(totalSize);
+            this->barrierStep = -1;
+        }
+
+        // find the lowest-barrier pathway between two points
+        void query(const std::vector<double>& initialPoint, const std::vector<double>& endPoint) {
+
+            assert(initialPoint.size() == static_cast<std::size_t>(this->dimension));
+            assert(endPoint.size() == static_cast<std::size_t>(this->dimension));
+
+            this->initialPoint = this->grid.toIndex(this->pmfData->RCToInternal(initialPoint));
+            this->endPoint = this->grid.toIndex(this->pmfData->RCToInternal(endPoint));
+
+            // merge more cells until the two points are in the same tree
+            // cells merged by previous queries are reused
+            // the roots only need to be compared again after a union, or when a point is merged
+            bool connected = this->inSameTree(this->initialPoint, this->endPoint);
+            while (!connected) {
+                if (this->mergedNum == this->grid.getTotalSize()) {
+                    std::cerr << "Error! The initial and end points are not connected!" << std::endl;
+                    exit(1);
+                }
+                std::int64_t point = this->order[this->mergedNum];
+                if (this->merge(point) || point == this->initialPoint || point == this->endPoint) {
+                    connected = this->inSameTree(this->initialPoint, this->endPoint);
+                }
+            }
+            this->barrierStep = this->connectedStep(this->initialPoint, this->endPoint);
+
+            this->extractPathway();
+        }
+
+        // the highest energy along the pathway
+        double getBarrier() const {
+            if (this->barrierStep == -1) {
+                std::cerr << "Error, no information about results!\n";
+                exit(1);
+            }
+            return this->pmfData->energy(this->order[this->barrierStep]);
+        }
+
+        // return the points explored when extracting the pathway
+        void getExploredPoints(std::vector<std::vector<double> > & pointList) const {
+
+            if (this->closeList.size() == 0) {
+                std::cerr << "Error, no information about results!\n";
+                exit(1);
+            }
+
+            pointList = {};
+            for (std::int64_t p:this->closeList) {
+                pointList.push_back(this->pmfData->internalToRC(this->grid.toPoint(p)));
+            }
+        }
+
+        // how many points have been explored when extracting the pathway
+        std::int64_t getExploredPointNum() const {
+            if (this->closeList.size() == 0) {
+                std::cerr << "Error, no information about results!\n";
+                exit(1);
+            }
+            return this->closeList.size();
+        }
+
+        // return the lowest-barrier pathway
+        void getResults(std::vector<std::vector<double> >& trajectory, std::vector<double>& energyResults) const {
+
+            if (this->closeList.size() == 0) {
+                std::cerr << "Error, no information about results!\n";
+                exit(1);
+            }
+
+            trajectory = {};
+            energyResults = {};
+
+            for (std::int64_t p:this->pathway) {
+                trajectory.push_back(this->pmfData->internalToRC(this->grid.toPoint(p)));
+                energyResults.push_back(this->pmfData->energy(p));
+            }
+        }
+
+    private:
+
+        // the root of the tree containing a point
+        // the forest is not compressed, so that linkStep stays meaningful
+        std::int64_t root(std::int64_t point) const {
+            while (this->father[point] != point) {
+                point = this->father[point];
+            }
+            return point;
+        }
+
+        // whether two points have both been merged into the same tree
+        bool inSameTree(std::int64_t a, std::int64_t b) const {
+            return this->step[a] < this->mergedNum && this->step[b] < this->mergedNum && this->root(a) == this->root(b);
+        }
+
+        // the step at which two points became connected, -1 if not yet
+        // one climbs from a point to its ancestor at steps not earlier than the last link,
+        // as trees are only linked by their roots
+        std::int64_t connectedStep(std::int64_t a, std::int64_t b) {
+
+            if (this->step[a] >= this->mergedNum || this->step[b] >= this->mergedNum) {
+                return -1;
+            }
+            if (a == b) {
+                return this->step[a];
+            }
+
+            // the ancestors of a and the step at which a is connected to them
+            this->ancestors.assign(1, a);
+            this->ancestorSteps.assign(1, this->step[a]);
+            while (this->father[a] != a) {
+                this->ancestorSteps.push_back(std::max(this->ancestorSteps.back(), this->linkStep[a]));
+                a = this->father[a];
+                this->ancestors.push_back(a);
+            }
+
+            std::int64_t bStep = this->step[b];
+            while (true) {
+                for (std::size_t i = 0; i < this->ancestors.size(); i++) {
+                    if (this->ancestors[i] == b) {
+                        return std::max(this->ancestorSteps[i], bStep);
+                    }
+                }
+                if (this->father[b] == b) {
+                    return -1;
+                }
+                bStep = std::max(bStep, this->linkStep[b]);
+                b = this->father[b];
+            }
+        }
+
+        // the bit in treeEdges linking a point to its neighbour
+        inline std::int64_t edge(std::int64_t point, int dim, int side) const {
+            return point * 2 * this->dimension + 2 * dim + (side > 0 ? 1 : 0);
+        }
+
+        // merge the next cell with its merged neighbours
+        // return whether any two trees were linked
+        bool merge(std::int64_t point) {
+
+            std::int64_t currentStep = this->mergedNum;
+            assert(this->step[point] == currentStep);
+            bool linked = false;
+
+            // the root of the tree of point, kept up to date along the unions
+            std::int64_t rootP = point;
+            for (int i = 0; i < this->dimension; i++) {
+                for (int side = -1; side <= 1; side += 2) {
+                    std::int64_t q = this->grid.neighbour(point, i, side);
+                    if (q == -1 || this->step[q] >= currentStep) {
+                        continue;
+                    }
+                    std::int64_t rootQ = this->root(q);
+                    if (rootP == rootQ) {
+                        continue;
+                    }
+
+                    // union by rank
+                    if (this->treeRank[rootP] < this->treeRank[rootQ]) {
+                        std::swap(rootP, rootQ);
+                    }
+                    this->father[rootQ] = rootP;
+                    this->linkStep[rootQ] = currentStep;
+                    if (this->treeRank[rootP] == this->treeRank[rootQ]) {
+                        this->treeRank[rootP]++;
+                    }
+                    linked = true;
+
+                    // the two cells are connected through this edge
+                    this->treeEdges.set(this->edge(point, i, side));
+                    this->treeEdges.set(this->edge(q, i, -side));
+                }
+            }
+
+            this->mergedNum++;
+            return linked;
+        }
+
+        // the edges recorded in merge form a minimax spanning forest,
+        // the pathway is the path between the two points in this forest
+        // it is found by breadth-first searches from both points, restricted to cells merged
+        // before the barrier, the side which has explored fewer points is expanded first
+        // cells reached from the initial point are open, those reached from the end point closed,
+        // and in a tree the two searches first meet on the pathway
+        void extractPathway() {
+
+            this->state.reset();
+            this->closeList.clear();
+            this->pathway.clear();
+
+            if (this->initialPoint == this->endPoint) {
+                this->closeList.push_back(this->initialPoint);
+                this->pathway.push_back(this->initialPoint);
+                return;
+            }
+
+            // the queues of both sides, and the next point of each to expand
+            this->queues[0].assign(1, this->initialPoint);
+            this->queues[1].assign(1, this->endPoint);
+            std::size_t heads[2] = {0, 0};
+            this->state.setOpen(this->initialPoint);
+            this->state.setClosed(this->endPoint);
+
+            // the two cells of the edge where the searches meet
+            std::int64_t meetForward = -1;
+            std::int64_t meetBackward = -1;
+            while (meetForward == -1) {
+                int side = heads[0] <= heads[1] ? 0 : 1;
+                if (heads[side] == this->queues[side].size()) {
+                    side = 1 - side;
+                }
+                assert(heads[side] < this->queues[side].size());
+                std::int64_t p = this->queues[side][heads[side]++];
+                this->closeList.push_back(p);
+                for (int i = 0; i < this->dimension && meetForward == -1; i++) {
+                    for (int s = -1; s <= 1; s += 2) {
+                        if (!this->treeEdges.test(this->edge(p, i, s))) {
+                            continue;
+                        }
+                        std::int64_t q = this->grid.neighbour(p, i, s);
+                        if (this->step[q] > this->barrierStep) {
+                            continue;
+                        }
+                        if (this->state.isNew(q)) {
+                            if (side == 0) {
+                                this->state.setOpen(q);
+                            }
+                            else {
+                                this->state.setClosed(q);
+                            }
+                            this->state.setParent(q, p);
+                            this->queues[side].push_back(q);
+                        }
+                        else if (side == 0 ? this->state.isClosed(q) : this->state.isOpen(q)) {
+                            // the cell of the other side is not expanded, but it is on the pathway
+                            this->closeList.push_back(q);
+                            meetForward = side == 0 ? p : q;
+                            meetBackward = side == 0 ? q : p;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            for (std::int64_t p = meetForward; p != -1; p = this->state.getParent(p)) {
+                this->pathway.push_back(p);
+            }
+            std::reverse(this->pathway.begin(), this->pathway.end());
+            for (std::int64_t p = meetBackward; p != -1; p = this->state.getParent(p)) {
+                this->pathway.push_back(p);
+            }
+        }
+
+        // the pmf data
+        const pmfParser::pmf<T>* pmfData;
+        // linear indices of the grid cells
+        gridIndex::gridIndex grid;
+        // the energies of the pmf as stored, indexed by linear index
+        const T* energy;
+        int dimension;
+
+        // cells sorted by energy, and the position of each cell in this order
+        std::vector<std::int64_t> order;
+        std::vector<std::int64_t> step;
+
+        // union-find forest of the merged cells
+        std::vector<std::int64_t> father;
+        // the step at which a root was linked to its father
+        std::vector<std::int64_t> linkStep;
+        std::vector<unsigned char> treeRank;
+        // edges along which cells were merged, 2 * dimension bits per cell
+        searchState::bitSet treeEdges;
+        // number of cells merged so far
+        std::int64_t mergedNum;
+        // the ancestors of a point and the steps at which it is connected to them, see connectedStep
+        std::vector<std::int64_t> ancestors;
+        std::vector<std::int64_t> ancestorSteps;
+
+        // below are vars of the current query
+        std::int64_t initialPoint;
+        std::int64_t endPoint;
+        // the step at which the two points became connected
+        std::int64_t barrierStep;
+        searchState::searchState state;
+        // the queues of the searches from the initial and the end point, kept between queries
+        std::vector<std::int64_t> queues[2];
+        std::vector<std::int64_t> closeList;
+        std::vector<std::int64_t> pathway;
+    };
+}
+
+#endif // MERGETREE_HPP
@@ -14,114 +14,495 @@
 //    end                   =    20, 1.0
 //    pbc                   =     0, 0
 //    writeExploredPoints   =     0                 //(unnecessary, defalut=0)
+//    engine                =     dijkstra          //(unnecessary, default=dijkstra)
+//                                                  //(bidirectional: search from both the initial and the end point,
+//                                                  // same barrier as dijkstra with fewer explored points)
+//                                                  //(mergeTree: lowest-barrier pathway by merging cells in the order of energies)
+//    barrierTree           =     0                 //(unnecessary, default=0)
+//                                                  //(build an index of barriers, report the barrier and only search its basin)
 //    target                =    20, 1.0, 0.1, 0.0  //(unnecessary, defines the targeted points and force constants)
 //                                                  //(can define more than one targets)
+//    queries               =   ./queries.txt       //(unnecessary, find many pathways on the same pmf)
+//                                                  //(initial and end can be omitted if queries are provided)
+//    threads               =     0                 //(unnecessary, default=0, number of queries run in parallel)
+//                                                  //(0 means all the cores)
+//    barrierField          =     0                 //(unnecessary, default=0)
+//                                                  //(explore the whole pmf from the initial point, write ./ref.barrier,
+//                                                  // a NAMD pmf of the lowest barrier from the initial point to each point,
+//                                                  // and ./ref.father, each point followed by its father point,
+//                                                  // which gives the pathway to any point. Only for the dijkstra engine)
+//    writeBias             =     0                 //(unnecessary, default=0)
+//                                                  //(write ./ref.bias, a NAMD pmf of the manhatton potential of the targets)
+//    paddedGrid            =     0                 //(unnecessary, default=0)
+//                                                  //(search a copy of the pmf with one more cell around each axis,
+//                                                  // faster neighbour lookups for more memory. Not for the mergeTree engine)
+//    storage               =     double            //(unnecessary, default=double, how the energies are kept in memory)
+//                                                  //(float32: 4 bytes per cell,
+//                                                  // quantized16: 2 bytes per cell, the energies are rounded to
+//                                                  // 65534 levels between the lowest and the highest one.
+//                                                  // The search reads the compact values, which may change the pathway
+//                                                  // among nearly equal energies; the reported energies are the stored ones)
+//    binaryPmf             =   ./ref.mpmf          //(unnecessary, a binary copy of the pmf, mapped into memory)
+//                                                  //(read instead of directory if it exists, otherwise written from directory
+//                                                  // in the type of storage. It is not updated if directory changes)
+//
+// In queries.txt, one pathway per line:
+//    # name ; initial  ; end     ; target (unnecessary, target of [mule] is used if omitted)
+//    q1     ; -20, 1.0 ; 20, 1.0
+//    q2     ; -20, 1.0 ; 20, 2.0 ; 0, 1.5, 0.1, 0.1
+//    the results of each pathway are written to ./ref_name.traj, ./ref_name.energy ...
 //
 
+#include <cassert>
 #include <cstdlib>
+#include <cstdint>
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#include "barrierTree.hpp"
+#include "mergeTree.hpp"
 #include "pathFinder.hpp"
 #include "pmfParser.hpp"
 #include "array/pystring.h"
 #include "ini/INIReader.h"
 
 // read NAMD pmf file
-const pmfParser::pmf<double>* readPMF(const std::string& fileName) {
-    return new pmfParser::pmf<double>(fileName);
+template <typename T>
+pmfParser::pmf<T>* readPMF(const std::string& fileName) {
+    return new pmfParser::pmf<T>(fileName);
 }
 
 // read general pmf file
-const pmfParser::pmf<double>* readPMF(
+template <typename T>
+pmfParser::pmf<T>* readPMF(
              const std::string& pmfFile,
              const std::vector<double>& lowerboundary,
              const std::vector<double>& width,
              const std::vector<double>& upperboundary
             ) {
-    return new pmfParser::pmf<double>(pmfFile, lowerboundary, width, upperboundary);
+    return new pmfParser::pmf<T>(pmfFile, lowerboundary, width, upperboundary);
 }
 
-// write data to a file
-void writeData(const std::string& file, const std::vector<std::vector<double> >& points) {
-    std::ofstream writeFile;
-    writeFile.open(file, std::ios::out);
-    if (!writeFile.is_open()) {
-        std::cerr << "Cannot open " << file << std::endl;
-        exit(1);
+// read a text pmf file directly into a floating-point type
+template <typename T>
+pmfParser::pmf<T>* readTextPMF(
+             bool NAMDpmf,
+             const std::string& pmfFile,
+             const std::vector<double>& lowerboundary,
+             const std::vector<double>& width,
+             const std::vector<double>& upperboundary,
+             std::true_type
+            ) {
+    return NAMDpmf ? readPMF<T>(pmfFile) : readPMF<T>(pmfFile, lowerboundary, width, upperboundary);
+}
+
+// read a text pmf file as doubles, then encode it into a quantized type
+template <typename T>
+pmfParser::pmf<T>* readTextPMF(
+             bool NAMDpmf,
+             const std::string& pmfFile,
+             const std::vector<double>& lowerboundary,
+             const std::vector<double>& width,
+             const std::vector<double>& upperboundary,
+             std::false_type
+            ) {
+    auto fullPmf = readTextPMF<double>(NAMDpmf, pmfFile, lowerboundary, width, upperboundary, std::true_type());
+    auto pmfInfo = new pmfParser::pmf<T>(*fullPmf);
+    delete fullPmf;
+    return pmfInfo;
+}
+
+// read the pmf into the type of storage T, from its binary copy if it exists
+// the binary copy is written otherwise
+// quantized energies are read as doubles first, then encoded
+template <typename T>
+pmfParser::pmf<T>* loadPMF(
+             bool NAMDpmf,
+             const std::string& pmfFile,
+             const std::vector<double>& lowerboundary,
+             const std::vector<double>& width,
+             const std::vector<double>& upperboundary,
+             const std::string& binaryPmf,
+             const std::vector<bool>& pbc
+            ) {
+    if (binaryPmf != "" && pmfParser::isBinaryFile(binaryPmf)) {
+        auto pmfInfo = readPMF<T>(binaryPmf);
+        if (pmfInfo->getPbc() != pbc) {
+            std::cout << "Warning! The pbc of " << binaryPmf << " differs from the config file, the config file is used" << std::endl;
+        }
+        return pmfInfo;
+    }
+
+    auto pmfInfo = readTextPMF<T>(NAMDpmf, pmfFile, lowerboundary, width, upperboundary, std::is_floating_point<T>());
+
+    if (binaryPmf != "") {
+        pmfInfo->writeBinaryFile(binaryPmf, pbc);
+        std::cout << "The PMF is written to " << binaryPmf << ", which will be read by the next runs" << std::endl;
     }
+    return pmfInfo;
+}
+
+// write data to a file
+// a large file is better written in the background, while it is being formatted
+void writeData(const std::string& file, const std::vector<std::vector<double> >& points, bool background = false) {
+    NdArray::textWriter writeFile(file, background);
     for (const auto& result:points) {
         for (const auto& item:result) {
-            writeFile << item << " ";
+            writeFile << item << ' ';
         }
-        writeFile << std::endl;
+        writeFile << '\n';
     }
     writeFile.close();
 }
 
 // write numbers to a file
 void writeData(const std::string& file, const std::vector<double>& data) {
-    std::ofstream writeFile;
-    writeFile.open(file, std::ios::out);
-    if (!writeFile.is_open()) {
-        std::cerr << "Cannot open " << file << std::endl;
-        exit(1);
-    }
+    NdArray::textWriter writeFile(file);
     for (const auto& item:data) {
-        writeFile << item << std::endl;
+        writeFile << item << '\n';
     }
     writeFile.close();
 }
 
+// a pathway to be found on the pmf
+struct pathQuery {
+    std::string outputPrefix;
+    std::vector<double> initialPoint;
+    std::vector<double> endPoint;
+    std::vector<std::vector<double> > targetedPoints;
+    std::vector<std::vector<double> > forceConstants;
+};
+
 // find optimized pathway
+// tree (mergeTree engine) and index (barrierTree) are shared by all the queries,
+// nullptr if not used
+// workspace is the search state reused by the queries of the same thread
+// messages are written to out
 // return the total number of points explored
-int findPathway(
-                 const pmfParser::pmf<double>* pmfInfo,
-                 const std::vector<double>& initialPoint,
-                 const std::vector<double>& endPoint,
+template <typename T>
+std::int64_t findPathway(
+                 const pmfParser::pmf<T>& pmfInfo,
+                 const pathQuery& query,
                  const std::vector<bool>& pbc,
-                 const std::string& outputPrefix,
-                 std::vector<std::vector<double> >& targetedPoints,
-                 std::vector<std::vector<double> >& forceConstants,
-                 bool writeExploredPoints = false
+                 std::ostream& out,
+                 bool writeExploredPoints = false,
+                 mergeTree::mergeTree<T>* tree = nullptr,
+                 const barrierTree::barrierTree<T>* index = nullptr,
+                 searchState::searchState* workspace = nullptr,
+                 bool barrierField = false,
+                 bool bidirectional = false,
+                 searchState::searchState* backwardWorkspace = nullptr,
+                 bool writeBias = false
                  ) {
-    auto pathFind = pathFinder::pathFinder(*pmfInfo, initialPoint, endPoint, pbc);
     std::vector<std::vector<double> > results;
     std::vector<double> energyResults;
+    // if one wants to write explored points
+    std::vector<std::vector<double> > exploredPoints;
+    std::int64_t exploredPointNum;
 
-    if (targetedPoints.size() != 0 && forceConstants.size() != 0) {
-        pathFind.setTargetedPoints(targetedPoints, forceConstants);
-        pathFind.Dijkstra(&pathFinder::pathFinder::manhattonPotential);
+    bool useTargets = (query.targetedPoints.size() != 0 && query.forceConstants.size() != 0);
+
+    if (index != nullptr) {
+        out << "The highest barrier along the lowest-barrier pathway: "
+            << index->getBarrier(query.initialPoint, query.endPoint) << std::endl;
     }
-    else {
-        pathFind.Dijkstra();
+
+    if (tree != nullptr) {
+        // targets are rejected with the mergeTree engine when reading the config and queries
+        assert(!useTargets);
+        // the tree grows during queries, so they cannot run in parallel
+        static std::mutex treeMutex;
+        std::lock_guard<std::mutex> lock(treeMutex);
+        tree->query(query.initialPoint, query.endPoint);
+        tree->getResults(results, energyResults);
+        if (writeExploredPoints) {
+            tree->getExploredPoints(exploredPoints);
+        }
+        exploredPointNum = tree->getExploredPointNum();
     }
+    else {
+        auto pathFind = pathFinder::pathFinder<T>(pmfInfo, query.initialPoint, query.endPoint, pbc, workspace);
+
+        // the basin is only meaningful without the manhatton potential
+        // and for the pathway to the end point
+        if (index != nullptr && !useTargets && !barrierField) {
+            std::vector<std::int64_t> basin;
+            index->getBasin(query.initialPoint, query.endPoint, basin);
+            pathFind.setRegion(basin);
+        }
+
+        if (useTargets) {
+            pathFind.setTargetedPoints(query.targetedPoints, query.forceConstants);
+            if (writeBias) {
+                NdArray::NdArray<double> biases(pmfInfo.getShape());
+                pathFind.getBiasField(biases);
+                pmfParser::pmf<double>(pmfInfo, std::move(biases)).writePmfFile(query.outputPrefix + ".bias");
+                out << "The manhatton potential is written to " << query.outputPrefix + ".bias\n";
+            }
+        }
+        // the manhatton potential of the targets is part of the cost searched,
+        // so no other heuristic is needed
+        if (barrierField) {
+            pathFind.flood();
+        }
+        else if (bidirectional) {
+            pathFind.bidirectional(heuristics::none(), backwardWorkspace);
+        }
+        else {
+            pathFind.Dijkstra();
+        }
 
-    pathFind.getResults(results, energyResults);
+        pathFind.getResults(results, energyResults);
+        if (writeExploredPoints) {
+            pathFind.getExploredPoints(exploredPoints);
+        }
+        exploredPointNum = pathFind.getExploredPointNum();
 
-    std::string trajFile = outputPrefix + ".traj";
-    std::string energyFile = outputPrefix + ".energy";
+        // write the barriers and father points of the whole pmf
+        if (barrierField) {
+            NdArray::NdArray<double> barriers(pmfInfo.getShape());
+            pathFind.getBarrierField(barriers);
+            pmfParser::pmf<double>(pmfInfo, std::move(barriers)).writePmfFile(query.outputPrefix + ".barrier");
 
-    // if one wants to write explored points
-    std::vector<std::vector<double> > exploredPoints;
-    std::string exploredPointsFile = outputPrefix + ".explored";
-    if (writeExploredPoints) {
-        pathFind.getExploredPoints(exploredPoints);
+            std::vector<std::vector<double> > fathers;
+            pathFind.getFatherPoints(fathers);
+            writeData(query.outputPrefix + ".father", fathers, true);
+        }
     }
 
+    std::string trajFile = query.outputPrefix + ".traj";
+    std::string energyFile = query.outputPrefix + ".energy";
+    std::string exploredPointsFile = query.outputPrefix + ".explored";
+
     // write traj and energy
     writeData(trajFile, results);
     writeData(energyFile, energyResults);
 
     // write explored points
     if (writeExploredPoints) {
-        writeData(exploredPointsFile, exploredPoints);
+        writeData(exploredPointsFile, exploredPoints, true);
+    }
+
+    return exploredPointNum;
+}
+
+// find all the pathways
+// the queries are distributed over threadNum threads,
+// each of which has its own search state
+template <typename T>
+void runQueries(
+                const pmfParser::pmf<T>& pmfInfo,
+                const std::vector<pathQuery>& queries,
+                const std::vector<bool>& pbc,
+                int threadNum,
+                bool writeExploredPoints = false,
+                mergeTree::mergeTree<T>* tree = nullptr,
+                const barrierTree::barrierTree<T>* index = nullptr,
+                bool barrierField = false,
+                bool bidirectional = false,
+                bool writeBias = false
+               ) {
+    std::atomic<std::size_t> nextQuery(0);
+    std::mutex outputMutex;
+
+    auto worker = [&]() {
+        searchState::searchState workspace, backwardWorkspace;
+        std::size_t i;
+        while ((i = nextQuery++) < queries.size()) {
+            const auto& query = queries[i];
+            std::ostringstream out;
+
+            out << "initial point: ";
+            for (const auto& item: query.initialPoint) out << item << " ";
+            out << std::endl;
+
+            out << "end point: ";
+            for (const auto& item: query.endPoint) out << item << " ";
+            out << std::endl;
+
+            if (query.targetedPoints.size() != 0 && query.forceConstants.size() != 0) {
+                out << "Target points: " << std::endl;
+                for (const auto& point: query.targetedPoints) {
+                    for (const auto& item: point) {
+                        out << item << " ";
+                    }
+                    out << std::endl;
+                }
+            }
+
+            std::int64_t exploredPointNum = findPathway(
+                                               pmfInfo,
+                                               query,
+                                               pbc,
+                                               out,
+                                               writeExploredPoints,
+                                               tree,
+                                               index,
+                                               &workspace,
+                                               barrierField,
+                                               bidirectional,
+                                               &backwardWorkspace,
+                                               writeBias
+                                              );
+
+            out << "Finished! See " << query.outputPrefix + ".traj" << " and " << query.outputPrefix + ".energy" << " for the results\n";
+            if (barrierField) {
+                out << "The barrier field is written to " << query.outputPrefix + ".barrier" << " and " << query.outputPrefix + ".father\n";
+            }
+            out << "A total of " << exploredPointNum << " points have been explored!\n";
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << out.str() << std::flush;
+        }
+    };
+
+    if (threadNum <= 1) {
+        worker();
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadNum; i++) {
+        threads.push_back(std::thread(worker));
+    }
+    for (auto& t:threads) {
+        t.join();
+    }
+}
+
+// build the trees and run all the queries on a pmf stored as T
+// the pmf is deleted at the end
+template <typename T>
+void solve(
+           pmfParser::pmf<T>* pmfInfo,
+           const std::vector<pathQuery>& queries,
+           const std::vector<bool>& pbc,
+           int threadNum,
+           bool writeExploredPoints,
+           const std::string& engine,
+           bool useBarrierTree,
+           bool barrierField,
+           bool writeBias,
+           bool paddedGrid
+          ) {
+    mergeTree::mergeTree<T>* tree = nullptr;
+    if (engine == "mergeTree") {
+        tree = new mergeTree::mergeTree<T>(*pmfInfo, pbc);
+    }
+    barrierTree::barrierTree<T>* index = nullptr;
+    if (useBarrierTree) {
+        index = new barrierTree::barrierTree<T>(*pmfInfo, pbc);
+    }
+
+    // the padded copy replaces the data, so it is made after the trees are built from them
+    if (paddedGrid && engine != "mergeTree") {
+        pmfInfo->pad(pbc);
+    }
+
+    // 0 means all the cores, and there is no need for more threads than queries
+    if (threadNum <= 0) {
+        threadNum = std::thread::hardware_concurrency();
+    }
+    if (static_cast<std::size_t>(threadNum) > queries.size()) {
+        threadNum = int(queries.size());
+    }
+    if (threadNum > 1) {
+        std::cout << "Running " << queries.size() << " queries on " << threadNum << " threads" << std::endl;
     }
 
+    runQueries(*pmfInfo, queries, pbc, threadNum, writeExploredPoints, tree, index, barrierField, engine == "bidirectional", writeBias);
+
+    delete index;
+    delete tree;
     delete pmfInfo;
-    pmfInfo = nullptr;
+}
+
+// read targeted points and force constants from a string like
+// "20, 1.0, 0.1, 0.0, 10, 2.0, 0.1, 0.1"
+void readTargets(
+                 const std::string& str,
+                 int dimension,
+                 std::vector<std::vector<double> >& targetedPoints,
+                 std::vector<std::vector<double> >& forceConstant
+                ) {
+    std::vector<std::string> tempTargetedPointsAndFCStr;
+    std::vector<double> tempPoint, tempFC;
+    pystring::split(str, tempTargetedPointsAndFCStr, ",");
+    for (std::size_t i = 0; i < tempTargetedPointsAndFCStr.size() / dimension / 2; i++) {
+        tempPoint = {};
+        tempFC = {};
+        for (int j = 0; j < dimension; j++) {
+            tempPoint.push_back(std::stod(tempTargetedPointsAndFCStr[dimension * 2 * i + j]));
+            tempFC.push_back(std::stod(tempTargetedPointsAndFCStr[dimension * 2 * i + dimension + j]));
+        }
+        targetedPoints.push_back(tempPoint);
+        forceConstant.push_back(tempFC);
+    }
+}
+
+// read the queries of the batch mode
+// queries without a target use the targets of the config file
+// targets are not supported by the mergeTree engine
+void readQueries(
+                 const std::string& file,
+                 const std::string& outputPrefix,
+                 int dimension,
+                 const std::vector<std::vector<double> >& targetedPoints,
+                 const std::vector<std::vector<double> >& forceConstant,
+                 const std::string& engine,
+                 std::vector<pathQuery>& queries
+                ) {
+    std::ifstream readFile;
+    readFile.open(file, std::ios::in);
+    if (!readFile.is_open()) {
+        std::cerr << "Cannot open " << file << std::endl;
+        exit(1);
+    }
+
+    std::string line;
+    std::vector<std::string> splitedLine, tempInitialStr, tempEndStr;
+    while (getline(readFile, line)) {
+        line = pystring::strip(line);
+        if (line.size() == 0 || pystring::startswith(line, "#")) {
+            continue;
+        }
+        pystring::split(line, splitedLine, ";");
+        if (splitedLine.size() < 3) {
+            std::cerr << "Error, cannot parse query " << line << std::endl;
+            exit(1);
+        }
+
+        pathQuery query;
+        query.outputPrefix = outputPrefix + "_" + pystring::strip(splitedLine[0]);
+        pystring::split(splitedLine[1], tempInitialStr, ",");
+        pystring::split(splitedLine[2], tempEndStr, ",");
+        for (auto& item: tempInitialStr) query.initialPoint.push_back(std::stod(item));
+        for (auto& item: tempEndStr) query.endPoint.push_back(std::stod(item));
+        if (query.initialPoint.size() != static_cast<std::size_t>(dimension) || query.endPoint.size() != static_cast<std::size_t>(dimension)) {
+            std::cerr << "Error, wrong dimension of query " << line << std::endl;
+            exit(1);
+        }
+
+        if (splitedLine.size() > 3 && pystring::strip(splitedLine[3]) != "") {
+            readTargets(splitedLine[3], dimension, query.targetedPoints, query.forceConstants);
+            if (engine == "mergeTree" && query.targetedPoints.size() != 0) {
+                std::cerr << "Error, targeted points are not supported by the mergeTree engine, in query " << line << std::endl;
+                exit(1);
+            }
+        }
+        else {
+            query.targetedPoints = targetedPoints;
+            query.forceConstants = forceConstant;
+        }
+        queries.push_back(query);
+    }
 
-    return pathFind.getExploredPointNum();
+    readFile.close();
 }
 
 // read input pars from config file
@@ -137,7 +518,16 @@ void readConfig(
                 std::string& outputPrefix,
                 std::vector<std::vector<double> >& targetedPoints,
                 std::vector<std::vector<double> >& forceConstant,
-                bool & writeExploredPoints
+                bool & writeExploredPoints,
+                std::string& engine,
+                bool& useBarrierTree,
+                std::string& queryFile,
+                int& threadNum,
+                bool& barrierField,
+                bool& writeBias,
+                bool& paddedGrid,
+                std::string& storage,
+                std::string& binaryPmf
                ) {
     INIReader reader(file);
     if (reader.ParseError() != 0) {
@@ -156,9 +546,30 @@ void readConfig(
     auto tempTargetedPointsAndFC = reader.Get("mule", "target", "");
 
     writeExploredPoints = reader.GetBoolean("mule", "writeExploredPoints", false);
+    engine = reader.Get("mule", "engine", "dijkstra");
+    useBarrierTree = reader.GetBoolean("mule", "barrierTree", false);
+    if (engine != "dijkstra" && engine != "bidirectional" && engine != "mergeTree") {
+        std::cerr << "Error, unknown engine " << engine << "!" << std::endl;
+        exit(1);
+    }
+    queryFile = reader.Get("mule", "queries", "");
+    threadNum = reader.GetInteger("mule", "threads", 0);
+    barrierField = reader.GetBoolean("mule", "barrierField", false);
+    if (barrierField && engine != "dijkstra") {
+        std::cerr << "Error, barrierField is only available for the dijkstra engine!" << std::endl;
+        exit(1);
+    }
+    writeBias = reader.GetBoolean("mule", "writeBias", false);
+    paddedGrid = reader.GetBoolean("mule", "paddedGrid", false);
+    storage = reader.Get("mule", "storage", "double");
+    binaryPmf = reader.Get("mule", "binaryPmf", "");
+    if (storage != "double" && storage != "float32" && storage != "quantized16") {
+        std::cerr << "Error, unknown storage " << storage << "!" << std::endl;
+        exit(1);
+    }
 
     std::vector<std::string> tempLowerboundaryStr, tempUpperboundaryStr, tempWidthStr;
-    std::vector<std::string> tempInitialStr, tempEndStr, tempPbcStr, tempTargetedPointsAndFCStr;
+    std::vector<std::string> tempInitialStr, tempEndStr, tempPbcStr;
     if (tempLowerboundary != "" && tempUpperboundary != "" && tempWidth != "") {
         pystring::split(tempLowerboundary, tempLowerboundaryStr, ",");
         pystring::split(tempUpperboundary, tempUpperboundaryStr, ",");
@@ -168,26 +579,27 @@ void readConfig(
         for (auto& item: tempWidthStr) width.push_back(std::stod(item));
     }
 
-    pystring::split(tempInitial, tempInitialStr, ",");
-    pystring::split(tempEnd, tempEndStr, ",");
+    // initial and end point can be omitted in the batch mode
+    if (tempInitial != "" && tempEnd != "") {
+        pystring::split(tempInitial, tempInitialStr, ",");
+        pystring::split(tempEnd, tempEndStr, ",");
+        for (auto& item: tempInitialStr) initialPoint.push_back(std::stod(item));
+        for (auto& item: tempEndStr) endPoint.push_back(std::stod(item));
+    }
+    else if (queryFile == "") {
+        std::cerr << "Error, initial and end points must be provided!" << std::endl;
+        exit(1);
+    }
     pystring::split(tempPbc, tempPbcStr, ",");
-    for (auto& item: tempInitialStr) initialPoint.push_back(std::stod(item));
-    for (auto& item: tempEndStr) endPoint.push_back(std::stod(item));
     for (auto& item: tempPbcStr) pbc.push_back(std::stoi(item));
 
     // targeted points
+    // pbc is always given for each dimension
     if (tempTargetedPointsAndFC != "") {
-        std::vector<double> tempPoint, tempFC;
-        pystring::split(tempTargetedPointsAndFC, tempTargetedPointsAndFCStr, ",");
-        for (int i = 0; i < tempTargetedPointsAndFCStr.size() / initialPoint.size() / 2; i++) {
-            tempPoint = {};
-            tempFC = {};
-            for (int j = 0; j < initialPoint.size(); j++) {
-                tempPoint.push_back(std::stod(tempTargetedPointsAndFCStr[initialPoint.size() * 2 * i + j]));
-                tempFC.push_back(std::stod(tempTargetedPointsAndFCStr[initialPoint.size() * 2 * i + initialPoint.size() + j]));
-            }
-            targetedPoints.push_back(tempPoint);
-            forceConstant.push_back(tempFC);
+        readTargets(tempTargetedPointsAndFC, pbc.size(), targetedPoints, forceConstant);
+        if (engine == "mergeTree" && targetedPoints.size() != 0) {
+            std::cerr << "Error, targeted points are not supported by the mergeTree engine!" << std::endl;
+            exit(1);
         }
     }
 
@@ -213,6 +625,15 @@ int main(int argc, char* argv[]) {
     std::vector<double> endPoint;
     std::vector<bool> pbc;
     bool writeExploredPoints;
+    std::string engine;
+    bool useBarrierTree;
+    std::string queryFile;
+    int threadNum;
+    bool barrierField;
+    bool writeBias;
+    bool paddedGrid;
+    std::string storage;
+    std::string binaryPmf;
     std::string outputPrefix;
     std::vector<std::vector<double> > targetedPoints;
     std::vector<std::vector<double> > forceConstants;
@@ -234,11 +655,33 @@ int main(int argc, char* argv[]) {
                outputPrefix,
                targetedPoints,
                forceConstants,
-               writeExploredPoints
+               writeExploredPoints,
+               engine,
+               useBarrierTree,
+               queryFile,
+               threadNum,
+               barrierField,
+               writeBias,
+               paddedGrid,
+               storage,
+               binaryPmf
                );
 
+    // all the pathways to be found
+    std::vector<pathQuery> queries;
+    if (queryFile != "") {
+        std::cout << "Reading queries from " << queryFile << std::endl;
+        readQueries(queryFile, outputPrefix, pbc.size(), targetedPoints, forceConstants, engine, queries);
+    }
+    else {
+        queries.push_back(pathQuery{outputPrefix, initialPoint, endPoint, targetedPoints, forceConstants});
+    }
+
     bool NAMDpmf = (lowerboundary.size() == 0 || upperboundary.size() == 0 || width.size() == 0);
-    if (NAMDpmf) {
+    if (binaryPmf != "" && pmfParser::isBinaryFile(binaryPmf)) {
+        std::cout << "Reading binary PMF file " << binaryPmf << std::endl;
+    }
+    else if (NAMDpmf) {
         std::cout << "Reading NAMD PMF file " << pmfPath << std::endl;
         std::cout << "Lowerboundary, upperboundary and width will be read from the PMF file!" << std::endl;
     }
@@ -258,38 +701,21 @@ int main(int argc, char* argv[]) {
         std::cout << std::endl;
     }
 
-    std::cout << "initial point: ";
-    for (const auto& item: initialPoint) std::cout << item << " ";
-    std::cout << std::endl;
-
-    std::cout << "end point: ";
-    for (const auto& item: endPoint) std::cout << item << " ";
-    std::cout << std::endl;
-
-    if (targetedPoints.size() != 0 && forceConstants.size() != 0) {
-        std::cout << "Target points: " << std::endl;
-        for (const auto& point: targetedPoints) {
-            for (const auto& item: point) {
-                std::cout << item << " ";
-            }
-            std::cout << std::endl;
-        }
+    // the pmf is read only once and shared by all the queries
+    // it is kept as doubles, floats or 16-bit codes
+    if (storage == "float32") {
+        auto pmfInfo = loadPMF<float>(NAMDpmf, pmfPath, lowerboundary, width, upperboundary, binaryPmf, pbc);
+        solve(pmfInfo, queries, pbc, threadNum, writeExploredPoints, engine, useBarrierTree, barrierField, writeBias, paddedGrid);
+    }
+    else if (storage == "quantized16") {
+        auto pmfInfo = loadPMF<std::uint16_t>(NAMDpmf, pmfPath, lowerboundary, width, upperboundary, binaryPmf, pbc);
+        std::cout << "The energies are quantized into 16 bits, with a step of " << pmfInfo->getCodec().scale << std::endl;
+        solve(pmfInfo, queries, pbc, threadNum, writeExploredPoints, engine, useBarrierTree, barrierField, writeBias, paddedGrid);
+    }
+    else {
+        auto pmfInfo = loadPMF<double>(NAMDpmf, pmfPath, lowerboundary, width, upperboundary, binaryPmf, pbc);
+        solve(pmfInfo, queries, pbc, threadNum, writeExploredPoints, engine, useBarrierTree, barrierField, writeBias, paddedGrid);
     }
 
-    auto pmfInfo = NAMDpmf ? readPMF(pmfPath) : readPMF(pmfPath, lowerboundary, width, upperboundary);
-
-    int exploredPointNum = findPathway(
-                                       pmfInfo,
-                                       initialPoint,
-                                       endPoint,
-                                       pbc,
-                                       outputPrefix,
-                                       targetedPoints,
-                                       forceConstants,
-                                       writeExploredPoints
-                                      );
-
-    std::cout << "Finished! See " << outputPrefix + ".traj" << " and " << outputPrefix + ".energy" << " for the results\n";
-    std::cout << "A total of " << exploredPointNum << " points have been explored!\n";
     return 0;
 }
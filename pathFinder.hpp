@@ -2,23 +2,42 @@
 #define PATHFINDER_HPP
 
 #include <cstdlib>
+#include <cstdint>
 #include <cassert>
+#include <algorithm>
+#include <limits>
+#include <memory>
 #include <vector>
-#include <map>
 
+#include "binaryHeap.hpp"
+#include "gridIndex.hpp"
+#include "heuristics.hpp"
 #include "pmfParser.hpp"
+#include "quantization.hpp"
+#include "searchState.hpp"
 
 // find the optimal pathway connecting two points on a pmf
 // Usage:
 //   // run calculation
-//   auto path = pathFinder(pmfData, initialPoint, endPoint, pbc)
+//   // T is the storage type of the pmf, double, float or quantized (see quantization.hpp)
+//   // the search reads the stored values, only the reported energies are decoded
+//   auto path = pathFinder<T>(pmfData, initialPoint, endPoint, pbc)
 //   path.Dijkstra()
 //   // one may want to add external manhatton potential
+//   // it is added to the energies once, into the cost read by the search
 //   path.setTargetedPoints(
 //                          {{19.5,2.2},{20.0,2.5}},
 //                          {{1.0,1.0},{1.0,1.0}}
 //                         )
-//   path.Dijkstra(pathFinder::manhattonPotential)
+//   path.Dijkstra()
+//   // or any other h(x), see heuristics.hpp
+//   path.Dijkstra(heuristics::harmonic(path.getGrid(), pmfData.RCToInternal({20.0,2.5}), {0.1,0.1}))
+//   // the manhatton potential of each point
+//   NdArray::NdArray<double> biases(shape)
+//   path.getBiasField(biases)
+//   // the search can be restricted to a set of cells (linear indices),
+//   // for instance the basin found by barrierTree
+//   path.setRegion(cells)
 //   // get results
 //   std::vector<std::vector<double> > trajectory
 //   std::vector<double> energyResults
@@ -28,21 +47,38 @@
 //   path.getExploredPoints(pointList)
 //   // get the number of points explored
 //   auto num = path.getExploredPointNum()
+//   // or search from both the initial and the end point,
+//   // which gives a pathway with the same barrier and explores fewer points
+//   path.bidirectional()
+//   // or explore the whole grid from the initial point
+//   path.flood()
+//   // the highest energy along the pathway from the initial point to each cell
+//   NdArray::NdArray<double> barriers(shape)
+//   path.getBarrierField(barriers)
+//   // each cell followed by its father point
+//   std::vector<std::vector<double> > fathers
+//   path.getFatherPoints(fathers)
+//   // the per-cell search state can be provided by the caller
+//   // and reused by the next pathFinder on the same grid
+//   searchState::searchState workspace;
+//   auto path2 = pathFinder<T>(pmfData, initialPoint, endPoint, pbc, &workspace)
 //
 
 namespace pathFinder {
 
     // find the optimal pathway connecting two points on a PMF
+    template <typename T = double>
     class pathFinder {
 
     public:
 
         // constructor
         pathFinder(
-                   const pmfParser::pmf<double>& pmfData,
+                   const pmfParser::pmf<T>& pmfData,
                    const std::vector<double>& initialPoint,
                    const std::vector<double>& endPoint,
-                   const std::vector<bool>& pbc
+                   const std::vector<bool>& pbc,
+                   searchState::searchState* workspace = nullptr
                    ) {
 
             assert(initialPoint.size() == endPoint.size());
@@ -57,50 +93,115 @@ namespace pathFinder {
             for (auto& b:this->upperboundary) {
                 b -= 1;
             }
-            this->width = std::vector<int>(this->pmfData->getDimension(), 1);
-            this->initialPoint = this->pmfData->RCToInternal(initialPoint);
-            this->endPoint = this->pmfData->RCToInternal(endPoint);
             this->pbc = pbc;
             this->dimension = this->pmfData->getDimension();
 
-            this->openList.push_back(this->initialPoint);
+            // the search works on linear (row-major) indices of the grid
+            // coordinates are only recovered when writing results
+            // if the pmf is padded, the padded layout is searched
+            if (this->pmfData->isPadded()) {
+                assert(this->pmfData->getPaddedGrid().getPbc() == pbc);
+                this->grid = this->pmfData->getPaddedGrid();
+                this->energy = this->pmfData->getPaddedData().getCArray();
+            }
+            else {
+                this->grid = gridIndex::gridIndex(this->pmfData->getShape(), pbc);
+                this->energy = this->pmfData->getPmfData().getCArray();
+            }
+            this->cost = this->energy;
+            this->costCodec = this->pmfData->getCodec();
+            this->adjacentPoints = std::vector<std::int64_t>(2 * this->dimension);
+            if (workspace != nullptr) {
+                // the workspace is reset before each search
+                if (workspace->getSize() != static_cast<std::size_t>(this->grid.getIndexSize())) {
+                    workspace->resize(this->grid.getIndexSize());
+                }
+                this->state = workspace;
+            }
+            else {
+                this->ownState.reset(new searchState::searchState(this->grid.getIndexSize()));
+                this->state = this->ownState.get();
+            }
+
+            this->initialPoint = this->grid.toIndex(this->pmfData->RCToInternal(initialPoint));
+            this->endPoint = this->grid.toIndex(this->pmfData->RCToInternal(endPoint));
         }
 
         // set targeted points and force constants
         // used in the A-star alg
-        void setTargetedPoints (std::vector<std::vector<double> >& points, std::vector<std::vector<double> >& forceConst) {
+        // the manhatton potential of every point is computed here once,
+        // and added to the energies into the cost read by the search
+        void setTargetedPoints (const std::vector<std::vector<double> >& points, const std::vector<std::vector<double> >& forceConst) {
             assert(points.size() == forceConst.size());
             for (int i = 0; i < points.size(); i++) {
                 this->targetedPoints.push_back(this->pmfData->RCToInternal(points[i]));
                 this->forceConstants.push_back(forceConst[i]);
             }
+            this->buildCost();
         }
 
-        // run the Dijkstra alg
-        void Dijkstra(double (pathFinder::*func)(const std::vector<int>& point) const = &pathFinder::defaultFunc) {
+        // only search the given cells (row-major positions, as the linear indices of barrierTree)
+        // the initial and end point must be inside the region
+        void setRegion(const std::vector<std::int64_t>& cells) {
+            this->region.resize(this->grid.getIndexSize());
+            for (std::int64_t p:cells) {
+                this->region.set(this->grid.fromCell(p));
+            }
+            this->hasRegion = true;
+            assert(this->region.test(this->initialPoint));
+            assert(this->region.test(this->endPoint));
+        }
 
-            // just a simple translation of the classical dijkstera alg
-            while (this->openList.size() != 0) {
-                auto p = this->popMin(this->openList, func);
-                this->closeList.push_back(p);
+        // run the Dijkstra alg
+        // h is h(x) in the A-star alg, see heuristics.hpp, none by default
+        template <typename H = heuristics::none>
+        void Dijkstra(const H& h = H()) {
+            this->search(h, true);
+        }
 
-                // the end point is found
-                if (p == this->endPoint) {
-                    break;
-                }
+        // run the Dijkstra alg from both the initial and the end point
+        // the side which has explored fewer points is expanded first
+        // the search stops once a point explored from one side has been reached by the other
+        // each side only explores points above the barrier after it has explored
+        // the other end point, so the two sides always meet below the barrier and
+        // the barrier of the pathway is the same as that of Dijkstra, but the pathway itself
+        // may differ below the barrier, as its second half follows the search from the end point
+        // backwardWorkspace is the search state of the end point side, as workspace in the constructor
+        template <typename H = heuristics::none>
+        void bidirectional(
+                           const H& h = H(),
+                           searchState::searchState* backwardWorkspace = nullptr
+                          ) {
+
+            searchState::searchState* backwardState = backwardWorkspace;
+            std::unique_ptr<searchState::searchState> ownBackwardState;
+            if (backwardState == nullptr) {
+                ownBackwardState.reset(new searchState::searchState(this->grid.getIndexSize()));
+                backwardState = ownBackwardState.get();
+            }
+            else if (backwardState->getSize() != static_cast<std::size_t>(this->grid.getIndexSize())) {
+                backwardState->resize(this->grid.getIndexSize());
+            }
 
-                for (const auto& q:this->findAdjacentPoints(p)) {
-                    if (commonTools::vectorInVectorOfVector(q, this->openList)) {
-                        ; // pass
-                    }
-                    else if (!commonTools::vectorInVectorOfVector(q, this->closeList)) {
-                        this->openList.push_back(q);
-                        this->fatherPoint[q] = p;
-                    }
-                }
+            switch (this->dimension) {
+                case 1: this->bidirectionalSearch<1>(h, backwardState); break;
+                case 2: this->bidirectionalSearch<2>(h, backwardState); break;
+                case 3: this->bidirectionalSearch<3>(h, backwardState); break;
+                case 4: this->bidirectionalSearch<4>(h, backwardState); break;
+                case 5: this->bidirectionalSearch<5>(h, backwardState); break;
+                case 6: this->bidirectionalSearch<6>(h, backwardState); break;
+                default: this->bidirectionalSearch<0>(h, backwardState);
             }
         }
 
+        // run the Dijkstra alg without stopping at the end point,
+        // until all the points connected to the initial point are explored
+        // the pathway to the end point is the same as that of Dijkstra
+        template <typename H = heuristics::none>
+        void flood(const H& h = H()) {
+            this->search(h, false);
+        }
+
         // return the explored points of dijkstera calculation
         void getExploredPoints(std::vector<std::vector<double> > & pointList) const {
 
@@ -110,13 +211,13 @@ namespace pathFinder {
             }
 
             pointList = {};
-            for (const auto &p:this->closeList) {
-                pointList.push_back(this->pmfData->internalToRC(p));
+            for (std::int64_t p:this->closeList) {
+                pointList.push_back(this->pmfData->internalToRC(this->grid.toPoint(p)));
             }
         }
 
         // how many points have been explored during the calculation
-        int getExploredPointNum() const {
+        std::int64_t getExploredPointNum() const {
             if (this->closeList.size() == 0) {
                 std::cerr << "Error, no information about results!\n";
                 exit(1);
@@ -132,160 +233,347 @@ namespace pathFinder {
                 exit(1);
             }
 
-            std::vector<std::vector<int> > internalTrajectory = {};
             trajectory = {};
             energyResults = {};
 
-            this->constructResults(this->endPoint, internalTrajectory);
-            internalTrajectory.push_back(this->endPoint);
-
-            for (const auto &p:internalTrajectory) {
-                trajectory.push_back(this->pmfData->internalToRC(p));
+            for (std::int64_t p:this->pathway) {
+                trajectory.push_back(this->pmfData->internalToRC(this->grid.toPoint(p)));
             }
 
-            for(const auto& p:internalTrajectory) {
-                energyResults.push_back((*(this->pmfData))[p]);
+            for(std::int64_t p:this->pathway) {
+                energyResults.push_back(this->energyOf(p));
             }
         }
 
-        // below are h(x) functions used in the A-star alg
-        inline double defaultFunc(const std::vector<int>& point) const {
-            return 0;
+        // the highest energy along the pathway from the initial point to each point
+        // points not explored are set to infinity
+        // without h(x), this is the lowest barrier between the initial point and the point
+        void getBarrierField(NdArray::NdArray<double>& barriers) const {
+
+            if (this->closeList.size() == 0) {
+                std::cerr << "Error, no information about results!\n";
+                exit(1);
+            }
+            assert(barriers.getTotalSize() == static_cast<std::size_t>(this->grid.getTotalSize()));
+
+            double* b = barriers.getCArray();
+            for (std::int64_t i = 0; i < this->grid.getTotalSize(); i++) {
+                b[i] = std::numeric_limits<double>::infinity();
+            }
+            // a father point is always explored before its children
+            for (std::int64_t p:this->closeList) {
+                std::int64_t father = this->state->getParent(p);
+                b[this->grid.toCell(p)] = (father == -1) ? this->energyOf(p) : std::max(b[this->grid.toCell(father)], this->energyOf(p));
+            }
         }
 
-        // Manhatton potential
-        double manhattonPotential(const std::vector<int>& point) const {
-            if (this->targetedPoints.size() == 0) {
-                return 0;
+        // all the explored points in row-major order, each followed by its father point
+        // the father point of the initial point is itself
+        // following the father points from any point leads back to the initial point
+        void getFatherPoints(std::vector<std::vector<double> >& fathers) const {
+
+            if (this->closeList.size() == 0) {
+                std::cerr << "Error, no information about results!\n";
+                exit(1);
+            }
+
+            fathers = {};
+            for (std::int64_t cell = 0; cell < this->grid.getTotalSize(); cell++) {
+                std::int64_t p = this->grid.fromCell(cell);
+                if (!this->state->isClosed(p)) {
+                    continue;
+                }
+                std::int64_t father = this->state->getParent(p);
+                auto line = this->pmfData->internalToRC(this->grid.toPoint(p));
+                auto fatherRC = this->pmfData->internalToRC(this->grid.toPoint(father == -1 ? p : father));
+                line.insert(line.end(), fatherRC.begin(), fatherRC.end());
+                fathers.push_back(line);
             }
+        }
+
+        // the grid searched, on which the heuristics are defined
+        const gridIndex::gridIndex& getGrid() const {
+            return this->grid;
+        }
+
+        // Manhatton potential of the targeted points
+        // it is already part of the cost searched once setTargetedPoints is called
+        double manhattonPotential(std::int64_t point) const {
             double energy = 0;
-            int distance = 0;
-            int d1, d2, d3;
             for (int i = 0; i < this->targetedPoints.size(); i++) {
-                for (int j = 0; j < this->targetedPoints[i].size(); j++) {
-                    distance = 0;
-                    if (this->pbc[j] == false) {
-                        distance = abs(point[j] - targetedPoints[i][j]);
-                    }
-                    else {
-                        d1 = abs(point[j] - targetedPoints[i][j]);
-                        d2 = (abs(point[j] - lowerboundary[j]) + abs(targetedPoints[i][j] - upperboundary[j]));
-                        d3 = (abs(point[j] - upperboundary[j]) + abs(targetedPoints[i][j] - lowerboundary[j]));
-                        distance = ((d1 < d2 ? d1 : d2) < d3) ? (d1 < d2 ? d1 : d2) : d3;
-                    }
-                    energy += distance * this->forceConstants[i][j];
+                for (int j = 0; j < this->dimension; j++) {
+                    energy += this->manhattonDistance(this->grid.coordinate(point, j), i, j) * this->forceConstants[i][j];
                 }
             }
             return energy;
         }
 
+        // the manhatton potential of each point, in the same layout as the pmf
+        void getBiasField(NdArray::NdArray<double>& biases) const {
+            assert(biases.getTotalSize() == static_cast<std::size_t>(this->grid.getTotalSize()));
+            std::vector<double> bias(this->grid.getIndexSize(), 0);
+            this->addBias(bias.data());
+            double* b = biases.getCArray();
+            for (std::int64_t cell = 0; cell < this->grid.getTotalSize(); cell++) {
+                b[cell] = bias[this->grid.fromCell(cell)];
+            }
+        }
+
     private:
 
-        // used in getResults
-        std::vector<int> constructResults(std::vector<int> point, std::vector<std::vector<int> >& internalTrajectory) {
-            if (this->fatherPoint.find(point) != this->fatherPoint.end()) {
-                internalTrajectory.push_back(constructResults(this->fatherPoint[point], internalTrajectory));
+        // the energy of a point
+        inline double energyOf(std::int64_t point) const {
+            return quantization::decode(this->energy[point], this->pmfData->getCodec());
+        }
+
+        // the cost of each point is its energy plus the manhatton potential
+        // the potential is summed first, so that the cost is the same as energy + h(x)
+        // the cost is then stored as the energies, encoded again if quantized
+        // the halo and the wall of a padded grid are never read by the search, they are set to +inf
+        // so that they do not widen the range of the quantized costs
+        void buildCost() {
+            std::vector<double> field(this->grid.getIndexSize(), 0);
+            this->addBias(field.data());
+            for (std::int64_t p = 0; p < this->grid.getIndexSize(); p++) {
+                if (this->grid.isPadded() && (p == this->grid.getWall() || this->grid.resolve(p) != p)) {
+                    field[p] = std::numeric_limits<double>::infinity();
+                }
+                else {
+                    field[p] += this->energyOf(p);
+                }
+            }
+            this->costCodec = quantization::take(field, this->effectiveCost);
+            this->cost = this->effectiveCost.data();
+        }
+
+        // the manhatton distance between coordinate coor and targeted point i along dimension j
+        int manhattonDistance(int coor, int i, int j) const {
+            int t = this->targetedPoints[i][j];
+            int d1 = abs(coor - t);
+            if (this->pbc[j] == false) {
+                return d1;
             }
-            return point;
+            int d2 = (abs(coor - this->lowerboundary[j]) + abs(t - this->upperboundary[j]));
+            int d3 = (abs(coor - this->upperboundary[j]) + abs(t - this->lowerboundary[j]));
+            return std::min(std::min(d1, d2), d3);
         }
 
-        // find the point that has the lowest energy in popList,
-        // remove it from the list and return it
-        std::vector<int> popMin(
-                                std::vector<std::vector<int> >& popList,
-                                double (pathFinder::*func)(const std::vector<int>& point) const = &pathFinder::defaultFunc
-                               ) {
+        // the manhatton potential is a sum of terms of each targeted point and dimension,
+        // so each term is tabulated over the coordinates of its dimension,
+        // and the table is added to the field in contiguous runs of points
+        // the terms are added in the same order as a point-by-point evaluation
+        // b has one value per linear index, initially zero
+        void addBias(double* b) const {
+
+            const auto& shape = this->pmfData->getShape();
+            const auto& indexShape = this->grid.getIndexShape();
+            int pad = this->grid.isPadded() ? 1 : 0;
+            // the wall, if any, is not a point of the grid
+            std::int64_t size = this->grid.isPadded() ? this->grid.getWall() : this->grid.getTotalSize();
 
-            assert(popList.size() != 0);
+            std::vector<double> axisTerm;
+            for (int i = 0; i < this->targetedPoints.size(); i++) {
+                for (int j = 0; j < this->dimension; j++) {
 
-            // func(popList[0]) is h(x) in A-star alg
-            // by default it is zero
-            double minEnergy = (*pmfData)[popList[0]] + (this->*func)(popList[0]);
-            int minPos = 0;
+                    // the potential along dimension j, halo cells of a padded grid get none
+                    axisTerm.assign(indexShape[j], 0);
+                    for (int coor = 0; coor < shape[j]; coor++) {
+                        axisTerm[coor + pad] = this->manhattonDistance(coor, i, j) * this->forceConstants[i][j];
+                    }
 
-            for (int i = 0; i < popList.size(); i++) {
-                if ((*pmfData)[popList[i]] + (this->*func)(popList[i]) < minEnergy) {
-                    minEnergy = (*pmfData)[popList[i]] + (this->*func)(popList[i]);
-                    minPos = i;
+                    std::int64_t stride = this->grid.getStrides()[j];
+                    for (std::int64_t block = 0; block < size; block += stride * indexShape[j]) {
+                        for (int coor = 0; coor < indexShape[j]; coor++) {
+                            double term = axisTerm[coor];
+                            double* run = b + block + coor * stride;
+                            for (std::int64_t k = 0; k < stride; k++) {
+                                run[k] += term;
+                            }
+                        }
+                    }
                 }
             }
+        }
+
+        // forget the previous search
+        // on a padded grid, the wall is closed so that it is never explored
+        void resetState(searchState::searchState* s) const {
+            s->reset();
+            if (this->grid.isPadded()) {
+                s->setClosed(this->grid.getWall());
+            }
+        }
 
-            auto minPoint = popList[minPos];
-            popList.erase(popList.begin() + minPos);
-            return minPoint;
+        // the key of a point in the open list
+        template <typename H>
+        inline double key(std::int64_t point, const H& h) const {
+            return quantization::decode(this->cost[point], this->costCodec) + h(point);
         }
 
-        // find the adjacent points of the input point,
-        // return them as a list
-        std::vector<std::vector<int> > findAdjacentPoints(const std::vector<int>& point) const {
+        // without heuristic, nothing is added,
+        // and the stored values are compared as they are, in the same order as the energies
+        inline double key(std::int64_t point, const heuristics::none&) const {
+            return this->cost[point];
+        }
+
+        // the Dijkstra alg, stop when the end point is explored if stopAtEnd
+        // the search loop is compiled for each dimension up to 6,
+        // higher dimensions use the generic loop (D = 0)
+        template <typename H>
+        void search(const H& h, bool stopAtEnd) {
+            switch (this->dimension) {
+                case 1: this->search<1>(h, stopAtEnd); break;
+                case 2: this->search<2>(h, stopAtEnd); break;
+                case 3: this->search<3>(h, stopAtEnd); break;
+                case 4: this->search<4>(h, stopAtEnd); break;
+                case 5: this->search<5>(h, stopAtEnd); break;
+                case 6: this->search<6>(h, stopAtEnd); break;
+                default: this->search<0>(h, stopAtEnd);
+            }
+        }
+
+        template <int D, typename H>
+        void search(const H& h, bool stopAtEnd) {
 
-            std::vector<std::vector<int> > adjacentPoints;
+            // just a simple translation of the classical dijkstera alg
+            // the open list is a heap keyed by cost + h(x),
+            // the cost is the energy, plus the manhatton potential of the targeted points if any
+            // h(point) is another h(x) in A-star alg, by default there is none
+            this->openList.clear();
+            this->closeList.clear();
+            this->resetState(this->state);
+            this->openList.push(this->initialPoint, this->key(this->initialPoint, h));
+            this->state->setOpen(this->initialPoint);
+            while (!this->openList.empty()) {
+                std::int64_t p = this->openList.pop();
+                this->closeList.push_back(p);
+                this->state->setClosed(p);
 
-            for (int i = 0; i < this->dimension; i++) {
-                // left side
-                auto p = point;
-                if (point[i] - this->width[i] >= this->lowerboundary[i] - commonTools::accuracy) {
-                    p[i] = point[i] - this->width[i];
+                // the end point is found
+                if (stopAtEnd && p == this->endPoint) {
+                    break;
                 }
-                else {
-                    if (this->pbc[i]) {
-                        p[i] = this->upperboundary[i];
-                    }
-                    else {
-                        p = {};
+
+                int adjacentNum = this->grid.findAdjacentPoints<D>(p, this->adjacentPoints.data());
+                for (int i = 0; i < adjacentNum; i++) {
+                    std::int64_t q = this->adjacentPoints[i];
+                    // neither in openList nor in closeList
+                    if (this->state->isNew(q) && (!this->hasRegion || this->region.test(q))) {
+                        this->openList.push(q, this->key(q, h));
+                        this->state->setOpen(q);
+                        this->state->setParent(q, p);
                     }
                 }
+            }
 
-                // right side
-                auto q = point;
-                if (point[i] + this->width[i] <= this->upperboundary[i] + commonTools::accuracy) {
-                    q[i] = point[i] + this->width[i];
-                }
-                else {
-                    if (this->pbc[i]) {
-                        q[i] = this->lowerboundary[i];
-                    }
-                    else {
-                        q = {};
-                    }
+            // follow the father points from the end point back to the initial point
+            this->pathway.clear();
+            for (std::int64_t p = this->endPoint; p != -1; p = this->state->getParent(p)) {
+                this->pathway.push_back(p);
+            }
+            std::reverse(this->pathway.begin(), this->pathway.end());
+        }
+
+        // the loop of bidirectional, compiled for each dimension as search
+        template <int D, typename H>
+        void bidirectionalSearch(const H& h, searchState::searchState* backwardState) {
+
+            binaryHeap::binaryHeap<std::int64_t> backwardOpenList;
+            searchState::searchState* states[2] = {this->state, backwardState};
+            binaryHeap::binaryHeap<std::int64_t>* openLists[2] = {&(this->openList), &backwardOpenList};
+            std::int64_t starts[2] = {this->initialPoint, this->endPoint};
+
+            this->closeList.clear();
+            for (int side = 0; side < 2; side++) {
+                openLists[side]->clear();
+                this->resetState(states[side]);
+                openLists[side]->push(starts[side], this->key(starts[side], h));
+                states[side]->setOpen(starts[side]);
+            }
+
+            std::int64_t meetingPoint = -1;
+            std::int64_t exploredNum[2] = {0, 0};
+            while (!this->openList.empty() && !backwardOpenList.empty()) {
+                int side = (exploredNum[0] <= exploredNum[1]) ? 0 : 1;
+                std::int64_t p = openLists[side]->pop();
+                // the meeting point may have been closed by the other side already
+                if (!states[1 - side]->isClosed(p)) {
+                    this->closeList.push_back(p);
                 }
+                states[side]->setClosed(p);
+                exploredNum[side]++;
 
-                if (p.size() != 0) {
-                    adjacentPoints.push_back(p);
+                // the two frontiers meet
+                // p has a father point explored from the other side
+                if (!states[1 - side]->isNew(p)) {
+                    meetingPoint = p;
+                    break;
                 }
-                if (q.size() != 0) {
-                    adjacentPoints.push_back(q);
+
+                int adjacentNum = this->grid.findAdjacentPoints<D>(p, this->adjacentPoints.data());
+                for (int i = 0; i < adjacentNum; i++) {
+                    std::int64_t q = this->adjacentPoints[i];
+                    if (states[side]->isNew(q) && (!this->hasRegion || this->region.test(q))) {
+                        openLists[side]->push(q, this->key(q, h));
+                        states[side]->setOpen(q);
+                        states[side]->setParent(q, p);
+                    }
                 }
             }
 
-            if (adjacentPoints.size() != 0) {
-                return adjacentPoints;
-            }
-            else {
-                std::cerr << "Error! No adjacent point is found!" << std::endl;
+            if (meetingPoint == -1) {
+                std::cerr << "Error! The initial and end points are not connected!" << std::endl;
                 exit(1);
             }
+
+            // initial point -> meeting point -> end point
+            this->pathway.clear();
+            for (std::int64_t p = meetingPoint; p != -1; p = this->state->getParent(p)) {
+                this->pathway.push_back(p);
+            }
+            std::reverse(this->pathway.begin(), this->pathway.end());
+            for (std::int64_t p = backwardState->getParent(meetingPoint); p != -1; p = backwardState->getParent(p)) {
+                this->pathway.push_back(p);
+            }
         }
 
         // the pmf data
-        const pmfParser::pmf<double>* pmfData;
+        const pmfParser::pmf<T>* pmfData;
         std::vector<int> lowerboundary;
         std::vector<int> upperboundary;
-        std::vector<int> width;
-        // initial and end point
-        std::vector<int> initialPoint;
-        std::vector<int> endPoint;
+        // linear indices of the grid cells
+        gridIndex::gridIndex grid;
+        // the energies of the pmf as stored, indexed by linear index
+        const T* energy;
+        // the cost searched, energy or effectiveCost, and how to decode it
+        const T* cost;
+        quantization::codec costCodec;
+        // energy + manhatton potential, only built with targeted points
+        std::vector<T> effectiveCost;
+        // initial and end point (linear indices)
+        std::int64_t initialPoint;
+        std::int64_t endPoint;
         // whether periodic for each dimension
         std::vector<bool> pbc;
         // dimension of pmf
         int dimension;
 
         // below are vars that will be used in dijkstra/A* algs
-        // record points' father point
-        std::map<std::vector<int>, std::vector<int> > fatherPoint = {};
+        // open/closed flags and father point of every cell
+        // either owned by the pathFinder or provided by the caller
+        searchState::searchState* state;
+        std::unique_ptr<searchState::searchState> ownState;
         // open and closeList in dijkstra/A* algs
-        std::vector<std::vector<int> > openList = {};
-        std::vector<std::vector<int> > closeList = {};
+        // closeList keeps the order in which the points are explored
+        binaryHeap::binaryHeap<std::int64_t> openList;
+        std::vector<std::int64_t> closeList = {};
+        // the pathway found, from the initial point to the end point
+        std::vector<std::int64_t> pathway;
+        // buffer of findAdjacentPoints, 2 * dimension points reused in every expansion
+        std::vector<std::int64_t> adjacentPoints;
+        // cells allowed in the search, if hasRegion
+        bool hasRegion = false;
+        searchState::bitSet region;
 
         // in the A* alg, one can define manhatton potential
         // based on targeted points and force constants
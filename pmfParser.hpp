@@ -3,11 +3,19 @@
 
 #include <iomanip>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <sstream>
 #include <vector>
 
 #include "array/NdArray.hpp"
 #include "array/NdArrayIo.hpp"
 #include "commonTools.h"
+#include "gridIndex.hpp"
+#include "quantization.hpp"
 
 // parsing pmf files
 // usage:
@@ -15,6 +23,19 @@
 //   auto a = pmf<double>("file.pmf")
 //   // read plain PMF file
 //   auto a = pmf<double>("file.pmf",{-20,0},{0.2,0.1},{20,3})
+//   // write a binary PMF file, and read it back
+//   // the energies of the binary file are mapped into memory and used in place
+//   a.writeBinaryFile("file.mpmf", {true,false})
+//   auto d = pmf<double>("file.mpmf")
+//   d.getPbc()                         // {true,false}, empty if not read from a binary file
+//   pmfParser::isBinaryFile("file.mpmf")
+//   // a pmf on the same grid as a, with other data
+//   auto b = pmf<double>(a, data)
+//   // the data of a in a compact type, float or 16-bit codes (see quantization.hpp)
+//   auto c = pmf<std::uint16_t>(a)
+//   c.energy(7)                        // the energy of the cell of row-major index 7
+//   c.stored(7)                        // the code stored for it
+//   c.getCodec()
 //   // write NAMD formmatted PMF file
 //   a.writePmfFile("file2.pmf")
 //   // get data
@@ -27,71 +48,122 @@
 //   a.getDimension()
 //   a.RCToInternal()
 //   a.internalToRC()
+//   // replace the data by a padded copy for the path finders,
+//   // with a halo of +inf around the grid
+//   // energy() and operator[] still take the unpadded positions, getPmfData() is no longer available
+//   a.pad({true,false})
+//   a.isPadded()
+//   a.getPaddedData()
+//   a.getPaddedGrid()
 //
 
 namespace pmfParser {
 
-    // pmf (T=double) or count (T=int) data
+    // binary pmf files, in native byte order
+    //   char[8]   "MULEPMF" and a zero byte
+    //   uint32    version, 1
+    //   uint32    0x01020304, to detect a file of the other byte order
+    //   uint32    type of the energies, 0 (double), 1 (float) or 2 (uint16, quantized)
+    //   uint32    dimension
+    //   uint64    position of the energies in the file, a multiple of 64
+    //   double    offset and scale of the energies (see quantization.hpp)
+    //   double    lowerboundary[dimension]
+    //   double    width[dimension]
+    //   int32     shape[dimension]
+    //   uint8     pbc[dimension]
+    // the energies follow in row-major order, at the given position
+    const char binaryMagic[8] = {'M', 'U', 'L', 'E', 'P', 'M', 'F', '\0'};
+    const std::uint32_t binaryVersion = 1;
+    const std::uint32_t binaryByteOrder = 0x01020304;
+
+    // the type code of the energies in binary files
+    template <typename T>
+    struct binaryType;
+
+    template <>
+    struct binaryType<double> {
+        static const std::uint32_t code = 0;
+    };
+
+    template <>
+    struct binaryType<float> {
+        static const std::uint32_t code = 1;
+    };
+
+    template <>
+    struct binaryType<std::uint16_t> {
+        static const std::uint32_t code = 2;
+    };
+
+    // whether a file is a binary pmf file
+    inline bool isBinaryFile(const std::string& file) {
+        std::ifstream readFile(file, std::ios::in | std::ios::binary);
+        char magic[8] = {};
+        readFile.read(magic, 8);
+        return readFile.gcount() == 8 && std::equal(magic, magic + 8, binaryMagic);
+    }
+
+    // pmf (T=double, float or a quantized unsigned type) or count (T=int) data
     template <typename T>
     class pmf {
 
     public:
 
-        // initialize the pmf using NAMD formatted file
+        // initialize the pmf using NAMD formatted file, or a binary file
         pmf(const std::string& pmfFile) {
 
             static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value, "T must be a kind of number");
 
-            std::ifstream readFile;
-            readFile.open(pmfFile, std::ios::in);
-            if (!readFile.is_open()) {
-                std::cerr << "file cannot be opened!" << std::endl;
-                exit(1);
+            if (isBinaryFile(pmfFile)) {
+                this->readBinaryFile(pmfFile);
+                return;
             }
 
-            // used for parsing
-            std::string line;
-            std::vector<std::string> splitedLine;
+            NdArray::textReader reader(pmfFile);
 
-            getline(readFile, line);
-            if (!pystring::startswith(line,"#")) {
+            // the header, "# dimension", then "# lb width shape pbc" for each dimension
+            if (!reader.nextLine() || !reader.startsWith('#') || !reader.skip() || !reader.read(this->dimension) || this->dimension <= 0) {
                 std::cerr << "This is not an NAMD PMF file!" << std::endl;
                 exit(1);
             }
 
-            // dimension
-            pystring::split(line, splitedLine);
-            this->dimension = std::stoi(splitedLine[1]);
-
             // lb, width and ub
             this->lowerboundary = std::vector<double>(this->dimension);
             this->upperboundary = std::vector<double>(this->dimension);
             this->width = std::vector<double>(this->dimension);
             this->shape = std::vector<int>(this->dimension);
             for (int i = 0; i < this->dimension; i++) {
-                getline(readFile, line);
-                pystring::split(line, splitedLine);
-                this->shape[i] = std::stoi(splitedLine[3]);
-                this->width[i] = std::stod(splitedLine[2]);
-                this->lowerboundary[i] = std::stod(splitedLine[1]) + 0.5 * this->width[i];
+                double lb;
+                if (!reader.nextLine() || !reader.skip() || !reader.read(lb) || !reader.read(this->width[i]) || !reader.read(this->shape[i])) {
+                    std::cerr << "Error! Incomplete header in " << pmfFile << "!" << std::endl;
+                    exit(1);
+                }
+                this->lowerboundary[i] = lb + 0.5 * this->width[i];
                 this->upperboundary[i] = this->lowerboundary[i] + this->width[i] * (this->shape[i] - 1);
             }
 
-            // reading data
+            // reading data, straight into the grid, in parallel chunks
+            // blank lines and comments are skipped
             this->data = new NdArray::NdArray<T>(this->shape);
-            std::vector<double> RCPosition(this->dimension);
-            while (getline(readFile, line)) {
-                pystring::split(line, splitedLine);
-                if (splitedLine.size() == 0) {
-                    continue;
-                }
-                for (int i = 0; i < this->dimension; i++) {
-                    RCPosition[i] = std::stod(splitedLine[i]);
+            reader.forEachChunk([&](NdArray::textReader& chunk, std::size_t) {
+                std::vector<double> RCPosition(this->dimension);
+                std::vector<int> point;
+                std::size_t index = 0;
+                while (chunk.nextLine()) {
+                    if (chunk.startsWith('#') || !chunk.read(RCPosition[0])) {
+                        continue;
+                    }
+                    double energy;
+                    for (int i = 1; i < this->dimension; i++) {
+                        chunk.read(RCPosition[i]);
+                    }
+                    if (!chunk.read(energy)) {
+                        std::cerr << "Error! Incomplete line " << chunk.getLineNumber() << " in " << pmfFile << "!" << std::endl;
+                        exit(1);
+                    }
+                    this->data->flat(this->nextIndex(RCPosition.data(), point, index)) = T(energy);
                 }
-                (*(this->data))[this->RCToInternal(RCPosition)] = std::stod(splitedLine[this->dimension]);
-            }
-
-            readFile.close();
+            });
         }
 
         // initialize the pmf given lb, ub, width
@@ -120,23 +192,67 @@ namespace pmfParser {
             }
             this->data = new NdArray::NdArray<T>(this->shape);
 
-            // read pmfFile into memory
-            auto datFormatData = NdArray::readDat(pmfFile, T(0));
-            auto datShape = datFormatData.getShape();
-            // convert it into internal data
-            std::vector<double> RCPosition;
-            for (int row = 0; row < datShape[0]; row++) {
-                RCPosition = std::vector<double>(this->dimension, 0);
-                for (int col = 0; col < datShape[1]; col++) {
-                    if (col < this->dimension) {
-                        RCPosition[col] = datFormatData[{row, col}];
+            // read pmfFile straight into the grid, in parallel chunks
+            // as doubles whatever T is, so that the coordinates are exact
+            // each line is "coordinates energy", missing numbers are 0, as in readDat
+            NdArray::textReader reader(pmfFile);
+            reader.forEachChunk([&](NdArray::textReader& chunk, std::size_t) {
+                std::vector<double> RCPosition(this->dimension);
+                std::vector<int> point;
+                std::size_t index = 0;
+                while (chunk.nextLine()) {
+                    if (chunk.startsWith('#') || !chunk.read(RCPosition[0])) {
+                        continue;
                     }
-                    else {
-                        (*(this->data))[this->RCToInternal(RCPosition)] = T(datFormatData[{row, col}]);
-                        break;
+                    double energy = 0;
+                    for (int i = 1; i < this->dimension; i++) {
+                        RCPosition[i] = 0;
+                        chunk.read(RCPosition[i]);
                     }
+                    chunk.read(energy);
+                    this->data->flat(this->nextIndex(RCPosition.data(), point, index)) = T(energy);
                 }
-            }
+            });
+        }
+
+        // initialize the pmf using the grid of another pmf and the given data
+        // the data are moved in if passed as an rvalue
+        template <typename U>
+        pmf(const pmf<U>& gridPmf, NdArray::NdArray<T> data) {
+
+            static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value, "T must be a kind of number");
+
+            assert(data.getShape() == gridPmf.getShape());
+
+            this->lowerboundary = gridPmf.getLowerboundary();
+            this->upperboundary = gridPmf.getUpperboundary();
+            this->width = gridPmf.getWidth();
+            this->shape = gridPmf.getShape();
+            this->dimension = gridPmf.getDimension();
+            this->pbc = gridPmf.getPbc();
+            this->data = new NdArray::NdArray<T>(std::move(data));
+        }
+
+        // a pmf owns its data, so it is not copied
+        pmf(const pmf&) = delete;
+        pmf& operator= (const pmf&) = delete;
+
+        // convert the data of another pmf into T,
+        // quantized over the range of the energies if T is an unsigned type
+        template <typename U>
+        explicit pmf(const pmf<U>& source) {
+
+            this->lowerboundary = source.getLowerboundary();
+            this->upperboundary = source.getUpperboundary();
+            this->width = source.getWidth();
+            this->shape = source.getShape();
+            this->dimension = source.getDimension();
+            this->pbc = source.getPbc();
+            this->data = new NdArray::NdArray<T>(this->shape);
+
+            std::vector<double> decoded;
+            const double* energies = energiesOf(source, decoded);
+            this->codec = quantization::encode(energies, this->data->getTotalSize(), this->data->getCArray());
         }
 
         // write internal data to a pmf file
@@ -144,34 +260,35 @@ namespace pmfParser {
         // note: PBCs are not recorded! So they are zeroes!
         void writePmfFile(const std::string& file) const {
 
-            std::ofstream writeFile;
-            writeFile.open(file, std::ios::out);
-            if (!writeFile.is_open()) {
-                std::cerr << "file cannot be opened!" << std::endl;
-                exit(1);
-            }
+            // the data are formatted into large blocks, written in the background
+            NdArray::textWriter writeFile(file, true);
 
             // the head of NAMD pmf file
-            writeFile << std::setw(2) << "# " << this->dimension << "\n";
+            std::ostringstream head;
+            head << std::setw(2) << "# " << this->dimension << "\n";
             for (int i = 0 ; i < this->dimension; i++) {
-                writeFile << "# "
-                          << std::setw(10) << this->lowerboundary[i] - 0.5 * this->width[i]
-                          << std::setw(10) << this->width[i]
-                          << std::setw(10) << this->shape[i] << " "
-                          << 0 << "\n";
+                head << "# "
+                     << std::setw(10) << this->lowerboundary[i] - 0.5 * this->width[i]
+                     << std::setw(10) << this->width[i]
+                     << std::setw(10) << this->shape[i] << " "
+                     << 0 << "\n";
             }
-            writeFile << "\n";
+            writeFile << head.str() << "\n";
 
             // iterate over any dimension
+            // the points are visited in row-major order, so the data are read by flat index
             int n = 0;
+            std::size_t index = 0;
             std::vector<int> loopFlag(this->dimension, 0);
             while (n >= 0) {
 
-                auto RC = this->internalToRC(loopFlag);
-                for (auto coor:RC) {
-                    writeFile << commonTools::round(coor, commonTools::decimal_acc) << " ";
+                // the coordinates as internalToRC, without allocation
+                for (int i = 0; i < this->dimension; i++) {
+                    double coor = double((loopFlag[i] * this->width[i]) + this->lowerboundary[i]);
+                    writeFile << commonTools::round(coor, commonTools::decimal_acc) << ' ';
                 }
-                writeFile << (*(this->data))[loopFlag] <<"\n";
+                this->writeValue(writeFile, index++, quantization::isQuantized<T>());
+                writeFile << '\n';
 
                 // mimic an nD for loop
                 n = this->dimension - 1;
@@ -191,11 +308,132 @@ namespace pmfParser {
             writeFile.close();
         }
 
+        // write the pmf into a binary file, see the top of pmfParser
+        // the energies are written as stored, so a quantized pmf stays quantized
+        // one should not overwrite the file the pmf was read from, as it may be mapped
+        void writeBinaryFile(const std::string& file, const std::vector<bool>& pbc) const {
+
+            assert(pbc.size() == static_cast<std::size_t>(this->dimension));
+
+            std::ofstream writeFile;
+            writeFile.open(file, std::ios::out | std::ios::binary);
+            if (!writeFile.is_open()) {
+                std::cerr << "file cannot be opened!" << std::endl;
+                exit(1);
+            }
+
+            auto write = [&writeFile](const void* source, std::size_t bytes) {
+                writeFile.write(static_cast<const char*>(source), bytes);
+            };
+
+            std::uint32_t type = binaryType<T>::code;
+            std::uint32_t dimension = this->dimension;
+            std::uint64_t headerSize = 8 + 4 * 4 + 8 + 2 * 8 + dimension * (8 + 8 + 4 + 1);
+            std::uint64_t dataPosition = (headerSize + NdArray::simd::alignment - 1) / NdArray::simd::alignment * NdArray::simd::alignment;
+
+            write(binaryMagic, 8);
+            write(&binaryVersion, 4);
+            write(&binaryByteOrder, 4);
+            write(&type, 4);
+            write(&dimension, 4);
+            write(&dataPosition, 8);
+            write(&(this->codec.offset), 8);
+            write(&(this->codec.scale), 8);
+            write(this->lowerboundary.data(), dimension * 8);
+            write(this->width.data(), dimension * 8);
+            for (int i = 0; i < this->dimension; i++) {
+                std::int32_t s = this->shape[i];
+                write(&s, 4);
+            }
+            for (int i = 0; i < this->dimension; i++) {
+                std::uint8_t p = pbc[i] ? 1 : 0;
+                write(&p, 1);
+            }
+            std::vector<char> padding(dataPosition - headerSize, 0);
+            write(padding.data(), padding.size());
+            write(this->getPmfData().getCArray(), this->getPmfData().getTotalSize() * sizeof(T));
+
+            if (!writeFile) {
+                std::cerr << "Error! Cannot write " << file << std::endl;
+                exit(1);
+            }
+            writeFile.close();
+        }
+
         // get the data (ndarray) of the pmf
+        // not kept once padded, see pad()
         const NdArray::NdArray<T>& getPmfData() const {
+            assert(this->data != nullptr);
             return *(this->data);
         }
 
+        // the energy of a cell given its row-major index
+        inline double energy(std::size_t index) const {
+            return quantization::decode(this->stored(index), this->codec);
+        }
+
+        // the stored value of a cell given its row-major index
+        inline const T& stored(std::size_t index) const {
+            if (this->data == nullptr) {
+                return this->paddedData->flat(this->paddedGrid.fromCell(index));
+            }
+            return this->data->flat(index);
+        }
+
+        // how the data are decoded into energies
+        const quantization::codec& getCodec() const {
+            return this->codec;
+        }
+
+        // build the padded copy of the data, see gridIndex
+        // the halo is never read, as gridIndex resolves the neighbours of the edge cells,
+        // so it is left as +inf, the code of +inf if quantized
+        // the unpadded data are then released, so only one copy of the grid is kept,
+        // the coordinates and the output files are not affected
+        void pad(const std::vector<bool>& pbc) {
+
+            assert(pbc.size() == static_cast<std::size_t>(this->dimension));
+            assert(this->data != nullptr);
+
+            this->paddedGrid = gridIndex::gridIndex(this->shape, pbc, true);
+            std::vector<int> paddedShape = this->shape;
+            for (auto& s:paddedShape) {
+                s += 2;
+            }
+            T wallValue = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+            delete this->paddedData;
+            this->paddedData = new NdArray::NdArray<T>(paddedShape, wallValue);
+
+            // the rows of the last axis are contiguous in both layouts
+            const T* source = this->data->getCArray();
+            T* target = this->paddedData->getCArray();
+            std::int64_t rowLength = this->shape[this->dimension - 1];
+            for (std::int64_t cell = 0; cell < this->paddedGrid.getTotalSize(); cell += rowLength) {
+                std::copy(source + cell, source + cell + rowLength, target + this->paddedGrid.fromCell(cell));
+            }
+            delete this->data;
+            this->data = nullptr;
+        }
+
+        bool isPadded() const {
+            return this->paddedData != nullptr;
+        }
+
+        // the padded data, indexed by the linear indices of getPaddedGrid()
+        const NdArray::NdArray<T>& getPaddedData() const {
+            assert(this->paddedData != nullptr);
+            return *(this->paddedData);
+        }
+
+        const gridIndex::gridIndex& getPaddedGrid() const {
+            return this->paddedGrid;
+        }
+
+        // the periodicity stored in a binary file, empty for the other formats
+        const std::vector<bool>& getPbc() const {
+            return this->pbc;
+        }
+
         // get lowerboundary, upperboundary, width, shape and dimension
         const std::vector<double>& getLowerboundary() const {
             return this->lowerboundary;
@@ -220,12 +458,15 @@ namespace pmfParser {
         // operator[] to get the desired item at a given RCPosition
         // one may note that the var type of operator[] is extremely important
         const T& operator[] (const std::vector<double>& RCPosition) const {
-            return (*(this->data))[this->RCToInternal(RCPosition)];
+            return (*this)[this->RCToInternal(RCPosition)];
         }
 
         // get the desired item using internal RC
         // this will make parsing PMF easier
         const T& operator[] (const std::vector<int>& internalPosition) const {
+            if (this->data == nullptr) {
+                return this->paddedData->flat(this->paddedGrid.toIndex(internalPosition));
+            }
             return (*(this->data))[internalPosition];
         }
 
@@ -240,6 +481,51 @@ namespace pmfParser {
             return internalPosition;
         }
 
+        // the row-major index of the cell of a reaction coordinate, as RCToInternal, without allocation
+        // the internal coordinate is also stored into internalPosition if given
+        std::size_t RCToIndex(const double* RCPosition, int* internalPosition = nullptr) const {
+            std::size_t index = 0;
+            for (int i = 0; i < this->dimension; i++) {
+                int internal = int((RCPosition[i] - this->lowerboundary[i] + commonTools::accuracy) / this->width[i]);
+                if (internal < 0 || internal >= this->shape[i]) {
+                    std::cerr << "Error! The point " << RCPosition[i] << " is out of the grid along dimension " << i + 1 << "!" << std::endl;
+                    exit(1);
+                }
+                if (internalPosition != nullptr) {
+                    internalPosition[i] = internal;
+                }
+                index = index * this->shape[i] + internal;
+            }
+            return index;
+        }
+
+        // the row-major index of the cell of the next line of a file
+        // point and index are those of the previous line (point is empty before the first one)
+        // while the lines come in row-major order, the line is only checked to be in the cell
+        // after the previous one, which needs no division, otherwise RCToIndex is used
+        std::size_t nextIndex(const double* RCPosition, std::vector<int>& point, std::size_t& index) const {
+            if (!point.empty()) {
+                // the cell after the previous one
+                int d = this->dimension - 1;
+                point[d]++;
+                while (d > 0 && point[d] == this->shape[d]) {
+                    point[d] = 0;
+                    point[--d]++;
+                }
+                bool inCell = point[0] < this->shape[0];
+                for (int i = 0; i < this->dimension && inCell; i++) {
+                    double low = this->lowerboundary[i] + point[i] * this->width[i] - commonTools::accuracy;
+                    inCell = RCPosition[i] >= low && RCPosition[i] < low + this->width[i];
+                }
+                if (inCell) {
+                    return ++index;
+                }
+            }
+            point.resize(this->dimension);
+            index = this->RCToIndex(RCPosition, point.data());
+            return index;
+        }
+
         // convert internal coordinate into external/real reaction coordinate
         std::vector<double> internalToRC(const std::vector<int>& internalPosition) const {
             assert(internalPosition.size() == this->dimension);
@@ -253,12 +539,128 @@ namespace pmfParser {
 
         ~pmf() {
             delete this->data;
+            delete this->paddedData;
         }
 
     private:
 
+        // the value of a cell in a pmf file, the stored one unless it is a code
+        void writeValue(NdArray::textWriter& writeFile, std::size_t index, std::false_type) const {
+            writeFile << this->stored(index);
+        }
+
+        void writeValue(NdArray::textWriter& writeFile, std::size_t index, std::true_type) const {
+            writeFile << this->energy(index);
+        }
+
+        // read a binary pmf file
+        // the file is mapped, and its energies are used in place if they are stored as T
+        void readBinaryFile(const std::string& file) {
+
+            auto mapping = std::make_shared<NdArray::mappedFile>(file);
+            const char* cursor = mapping->data();
+            const char* end = mapping->data() + mapping->size();
+            auto read = [&](void* target, std::size_t bytes) {
+                if (bytes > std::size_t(end - cursor)) {
+                    std::cerr << "Error! The binary PMF file " << file << " is truncated!" << std::endl;
+                    exit(1);
+                }
+                std::memcpy(target, cursor, bytes);
+                cursor += bytes;
+            };
+
+            char magic[8];
+            std::uint32_t version, byteOrder, type, dimension;
+            std::uint64_t dataPosition;
+            quantization::codec storedCodec;
+            read(magic, 8);
+            read(&version, 4);
+            read(&byteOrder, 4);
+            if (version != binaryVersion || byteOrder != binaryByteOrder) {
+                std::cerr << "Error! The binary PMF file " << file << " was written by another version or on another machine!" << std::endl;
+                exit(1);
+            }
+            read(&type, 4);
+            read(&dimension, 4);
+            read(&dataPosition, 8);
+            read(&(storedCodec.offset), 8);
+            read(&(storedCodec.scale), 8);
+
+            this->dimension = dimension;
+            this->lowerboundary = std::vector<double>(dimension);
+            this->width = std::vector<double>(dimension);
+            this->upperboundary = std::vector<double>(dimension);
+            this->shape = std::vector<int>(dimension);
+            this->pbc = std::vector<bool>(dimension);
+            read(this->lowerboundary.data(), dimension * 8);
+            read(this->width.data(), dimension * 8);
+            for (int i = 0; i < this->dimension; i++) {
+                std::int32_t s;
+                read(&s, 4);
+                this->shape[i] = s;
+                this->upperboundary[i] = this->lowerboundary[i] + this->width[i] * (s - 1);
+            }
+            for (int i = 0; i < this->dimension; i++) {
+                std::uint8_t p;
+                read(&p, 1);
+                this->pbc[i] = (p != 0);
+            }
+
+            std::size_t itemSize = (type == 0) ? sizeof(double) : (type == 1) ? sizeof(float) : (type == 2) ? sizeof(std::uint16_t) : 0;
+            std::size_t itemNum = NdArray::shapeProduct(this->shape);
+            if (itemSize == 0 || dataPosition % NdArray::simd::alignment != 0) {
+                std::cerr << "Error! The binary PMF file " << file << " is broken!" << std::endl;
+                exit(1);
+            }
+            if (dataPosition > mapping->size() || itemNum > (mapping->size() - dataPosition) / itemSize) {
+                std::cerr << "Error! The binary PMF file " << file << " is truncated!" << std::endl;
+                exit(1);
+            }
+
+            char* values = mapping->data() + dataPosition;
+            switch (type) {
+                case 0: this->useBinaryData(reinterpret_cast<double*>(values), storedCodec, mapping); break;
+                case 1: this->useBinaryData(reinterpret_cast<float*>(values), storedCodec, mapping); break;
+                case 2: this->useBinaryData(reinterpret_cast<std::uint16_t*>(values), storedCodec, mapping); break;
+            }
+        }
+
+        // energies stored as T are used in place, the mapping lives as long as the data
+        void useBinaryData(T* values, const quantization::codec& storedCodec, std::shared_ptr<void> mapping) {
+            this->data = new NdArray::NdArray<T>(this->shape, values, mapping);
+            this->codec = storedCodec;
+        }
+
+        // energies stored as another type are converted
+        template <typename U>
+        void useBinaryData(U* values, const quantization::codec& storedCodec, std::shared_ptr<void>) {
+            this->data = new NdArray::NdArray<T>(this->shape);
+            std::vector<double> energies(this->data->getTotalSize());
+            for (std::size_t i = 0; i < energies.size(); i++) {
+                energies[i] = quantization::decode(values[i], storedCodec);
+            }
+            this->codec = quantization::encode(energies.data(), energies.size(), this->data->getCArray());
+        }
+
+        // the energies of a pmf as doubles,
+        // those of a double pmf are read in place, the others are decoded into buffer
+        static const double* energiesOf(const pmf<double>& source, std::vector<double>&) {
+            return source.getPmfData().getCArray();
+        }
+
+        template <typename U>
+        static const double* energiesOf(const pmf<U>& source, std::vector<double>& buffer) {
+            buffer.resize(source.getPmfData().getTotalSize());
+            for (std::size_t i = 0; i < buffer.size(); i++) {
+                buffer[i] = source.energy(i);
+            }
+            return buffer.data();
+        }
+
         // the data (free energy) of the pmf
         NdArray::NdArray<T>* data;
+        // energy = codec.offset + codec.scale * data, identity unless quantized
+        quantization::codec codec;
         // lowerboundary, upperboundary, width, and dimension
         std::vector<double> lowerboundary;
         std::vector<double> upperboundary;
@@ -266,6 +668,11 @@ namespace pmfParser {
         // the shape of internal data
         std::vector<int> shape;
         int dimension;
+        // the periodicity read from a binary file
+        std::vector<bool> pbc;
+        // the padded copy of the data, nullptr if not padded
+        NdArray::NdArray<T>* paddedData = nullptr;
+        gridIndex::gridIndex paddedGrid;
     };
 }
 
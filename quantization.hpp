@@ -0,0 +1,122 @@
+#ifndef QUANTIZATION_HPP
+#define QUANTIZATION_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// compact storage of energies
+// a stored value v stands for the energy offset + scale * v
+// floating-point types keep the energies themselves (offset 0, scale 1),
+// integral types keep codes 0 ... max - 1 spread over the finite energies,
+// and the code max for +inf (the walls of a padded grid)
+// the mapping is increasing, so the stored values compare like the energies
+// usage:
+//   std::vector<std::uint16_t> codes(n);
+//   auto c = quantization::encode(energies, n, codes.data());
+//   quantization::decode(codes[i], c)      // energies[i], within c.scale / 2
+//   // move energies into values, encoded if the type differs
+//   quantization::take(energyVector, valueVector)
+//
+
+namespace quantization {
+
+    // the energy of a stored value is offset + scale * value
+    struct codec {
+        double offset = 0;
+        double scale = 1;
+    };
+
+    // whether the values of T are codes (the unsigned integral types),
+    // floating-point energies and int counts are stored as they are
+    template <typename T>
+    struct isQuantized : std::integral_constant<bool, std::is_integral<T>::value && std::is_unsigned<T>::value> {};
+
+    // the code of +inf of an integral type
+    template <typename T>
+    inline T infinityCode() {
+        return std::numeric_limits<T>::max();
+    }
+
+    template <typename T>
+    inline double decode(T value, const codec&, std::true_type) {
+        return value;
+    }
+
+    template <typename T>
+    inline double decode(T value, const codec& c, std::false_type) {
+        return value == infinityCode<T>() ? std::numeric_limits<double>::infinity() : c.offset + c.scale * value;
+    }
+
+    // the energy of a stored value
+    template <typename T>
+    inline double decode(T value, const codec& c) {
+        return decode(value, c, std::is_floating_point<T>());
+    }
+
+    template <typename T>
+    codec encode(const double* energies, std::size_t n, T* values, std::true_type) {
+        for (std::size_t i = 0; i < n; i++) {
+            values[i] = T(energies[i]);
+        }
+        return codec();
+    }
+
+    template <typename T>
+    codec encode(const double* energies, std::size_t n, T* values, std::false_type) {
+
+        // the range of the finite energies
+        double minE = std::numeric_limits<double>::infinity();
+        double maxE = -std::numeric_limits<double>::infinity();
+        for (std::size_t i = 0; i < n; i++) {
+            if (std::isfinite(energies[i])) {
+                minE = std::min(minE, energies[i]);
+                maxE = std::max(maxE, energies[i]);
+            }
+        }
+
+        codec c;
+        if (minE <= maxE) {
+            c.offset = minE;
+            c.scale = (maxE > minE) ? (maxE - minE) / (double(infinityCode<T>()) - 1) : 1;
+        }
+
+        for (std::size_t i = 0; i < n; i++) {
+            if (std::isfinite(energies[i])) {
+                values[i] = T(std::lround((energies[i] - c.offset) / c.scale));
+            }
+            else {
+                values[i] = infinityCode<T>();
+            }
+        }
+        return c;
+    }
+
+    // encode n energies into values, return how to decode them
+    template <typename T>
+    codec encode(const double* energies, std::size_t n, T* values) {
+        static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value, "T must be a kind of number");
+        return encode(energies, n, values, std::is_floating_point<T>());
+    }
+
+    // encode a field of energies into values, the energies are released
+    // a field of doubles is moved without any copy
+    template <typename T>
+    codec take(std::vector<double>& energies, std::vector<T>& values) {
+        values.resize(energies.size());
+        codec c = encode(energies.data(), energies.size(), values.data());
+        energies = std::vector<double>();
+        return c;
+    }
+
+    inline codec take(std::vector<double>& energies, std::vector<double>& values) {
+        values.swap(energies);
+        energies = std::vector<double>();
+        return codec();
+    }
+}
+
+#endif // QUANTIZATION_HPP
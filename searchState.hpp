@@ -0,0 +1,144 @@
+#ifndef SEARCHSTATE_HPP
+#define SEARCHSTATE_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// per-cell state of a graph search on a grid of linear indices
+// usage:
+//   searchState::searchState state(totalSize);
+//   state.setOpen(i);
+//   state.isOpen(i)
+//   state.setClosed(i);    // also removes it from the open set
+//   state.isClosed(i)
+//   state.setParent(i, j);
+//   state.getParent(i)     // -1 if i has no parent
+//   state.reset();         // forget everything, O(number of touched cells)
+//
+
+namespace searchState {
+
+    // a packed array of bits
+    class bitSet {
+
+    public:
+
+        bitSet(std::size_t size = 0) {
+            this->resize(size);
+        }
+
+        void resize(std::size_t size) {
+            this->words = std::vector<std::uint64_t>((size + 63) / 64, 0);
+        }
+
+        inline bool test(std::int64_t i) const {
+            return (this->words[i >> 6] >> (i & 63)) & 1;
+        }
+
+        inline void set(std::int64_t i) {
+            this->words[i >> 6] |= (std::uint64_t(1) << (i & 63));
+        }
+
+        inline void reset(std::int64_t i) {
+            this->words[i >> 6] &= ~(std::uint64_t(1) << (i & 63));
+        }
+
+        // the 64 bits from bit 64 * w
+        inline std::uint64_t word(std::size_t w) const {
+            return this->words[w];
+        }
+
+        std::size_t wordNum() const {
+            return this->words.size();
+        }
+
+    private:
+
+        std::vector<std::uint64_t> words;
+    };
+
+    // open/closed flags and parent of each cell
+    class searchState {
+
+    public:
+
+        searchState(std::size_t size = 0) {
+            this->resize(size);
+        }
+
+        // set the number of cells, all the cells become untouched
+        void resize(std::size_t size) {
+            this->size = size;
+            this->open.resize(size);
+            this->closed.resize(size);
+            this->parent = std::vector<std::int64_t>(size, -1);
+            this->touched.clear();
+        }
+
+        std::size_t getSize() const {
+            return this->size;
+        }
+
+        inline bool isOpen(std::int64_t i) const {
+            return this->open.test(i);
+        }
+
+        inline bool isClosed(std::int64_t i) const {
+            return this->closed.test(i);
+        }
+
+        // whether the cell has never been opened nor closed
+        inline bool isNew(std::int64_t i) const {
+            return !this->open.test(i) && !this->closed.test(i);
+        }
+
+        inline void setOpen(std::int64_t i) {
+            if (this->isNew(i)) {
+                this->touched.push_back(i);
+            }
+            this->open.set(i);
+        }
+
+        inline void setClosed(std::int64_t i) {
+            if (this->isNew(i)) {
+                this->touched.push_back(i);
+            }
+            this->open.reset(i);
+            this->closed.set(i);
+        }
+
+        inline std::int64_t getParent(std::int64_t i) const {
+            return this->parent[i];
+        }
+
+        inline void setParent(std::int64_t i, std::int64_t p) {
+            this->parent[i] = p;
+        }
+
+        // make all the cells untouched again
+        // only the cells touched since the last reset are visited
+        void reset() {
+            for (std::int64_t i:this->touched) {
+                this->open.reset(i);
+                this->closed.reset(i);
+                this->parent[i] = -1;
+            }
+            this->touched.clear();
+        }
+
+    private:
+
+        // number of cells
+        std::size_t size;
+        // whether a cell is in the open/close list
+        bitSet open;
+        bitSet closed;
+        // father point of each cell, -1 means none
+        std::vector<std::int64_t> parent;
+        // cells whose state has been changed since the last reset
+        std::vector<std::int64_t> touched;
+    };
+}
+
+#endif // SEARCHSTATE_HPP